@@ -0,0 +1,99 @@
+#ifndef SYSD_JAG_BENCH_CORPUS_HPP
+#define SYSD_JAG_BENCH_CORPUS_HPP
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sysd/buffer.hpp>
+#include <sysd/jag/archive.hpp>
+
+#include <spdlog/spdlog.h>
+
+namespace sysd::jag::bench {
+struct corpus_options {
+    std::size_t entries{64};
+    std::size_t min_size{1024};
+    std::size_t max_size{64 * 1024};
+    // the share of each entry made of repetitive data, from 0 for random
+    // noise which won't compress at all, to 100 for highly redundant data
+    std::size_t compressibility{50};
+    std::uint64_t seed{0x6a6167};
+};
+
+// splitmix64, used instead of the standard distributions so a corpus is
+// identical across standard library implementations
+struct generator {
+    explicit generator(std::uint64_t seed) : state{seed} {}
+
+    std::uint64_t next() {
+        auto z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    std::size_t between(std::size_t min, std::size_t max) {
+        return min + (max > min ? next() % (max - min + 1) : 0);
+    }
+
+  private:
+    std::uint64_t state;
+};
+
+std::string entry_name(std::size_t i) { return fmt::format("entry{}.dat", i); }
+
+// Generates size bytes of data in 64 byte chunks. Each chunk is either a run
+// of words from a small vocabulary, or random bytes, in proportion to the
+// requested compressibility.
+sysd::buffer::container_type make_entry(generator &gen, std::size_t size,
+                                        std::size_t compressibility) {
+    static const std::array<const char *, 8> words = {
+        "tile ", "npc ", "object ", "sprite ",
+        "0000 ", "wall ", "floor ", "\0\0\0\0\0"};
+
+    constexpr std::size_t chunk = 64;
+
+    sysd::buffer::container_type data{};
+    data.reserve(size);
+
+    while (data.size() < size) {
+        const auto len = std::min(chunk, size - data.size());
+
+        if (gen.next() % 100 < compressibility) {
+            for (std::size_t i = 0; i < len;) {
+                const auto *word = words[gen.next() % words.size()];
+
+                for (std::size_t j = 0; j < 5 && i < len; j++, i++) {
+                    data.push_back(word[j]);
+                }
+            }
+        } else {
+            for (std::size_t i = 0; i < len; i++) {
+                data.push_back(static_cast<char>(gen.next() & 0xff));
+            }
+        }
+    }
+
+    return data;
+}
+
+archive make_archive(const corpus_options &opts) {
+    generator gen{opts.seed};
+    archive arc{};
+
+    for (std::size_t i = 0; i < opts.entries; i++) {
+        const auto size = gen.between(opts.min_size, opts.max_size);
+        sysd::buffer data{make_entry(gen, size, opts.compressibility)};
+
+        arc.put(entry_name(i), data);
+    }
+
+    return arc;
+}
+} // namespace sysd::jag::bench
+
+#endif // SYSD_JAG_BENCH_CORPUS_HPP
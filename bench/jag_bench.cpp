@@ -0,0 +1,500 @@
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <spdlog/spdlog.h>
+#include <sysd/buffer.hpp>
+#include <sysd/jag/archive.hpp>
+#include <sysd/jag/archive_set.hpp>
+#include <sysd/jag/archive_view.hpp>
+#include <sysd/jag/checksum.hpp>
+#include <sysd/jag/detail/compressor.hpp>
+#include <sysd/jag/detail/crc32.hpp>
+#include <sysd/jag/detail/decompressor.hpp>
+#include <sysd/jag/detail/entry_encode.hpp>
+#include <sysd/jag/detail/estimate.hpp>
+#include <sysd/jag/index.hpp>
+#include <sysd/jag/overlay.hpp>
+#include <sysd/jag/serialize.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include "corpus.hpp"
+
+namespace bench = sysd::jag::bench;
+
+namespace {
+// Benchmarks taking an archive are parameterised on its entry count, the
+// largest entry size and compressibility, in that order.
+bench::corpus_options corpus_of(const benchmark::State &state) {
+    bench::corpus_options opts{};
+
+    opts.entries = state.range(0);
+    opts.max_size = state.range(1);
+    opts.min_size = std::min(opts.min_size, opts.max_size);
+    opts.compressibility = state.range(2);
+
+    return opts;
+}
+
+// An extra corpus can be benchmarked by setting JAG_BENCH_CORPUS to its
+// entry count, largest entry size and compressibility, such as "1000,8192,70"
+void corpus_args(benchmark::internal::Benchmark *b) {
+    b->Args({16, 4 * 1024, 50})
+        ->Args({256, 16 * 1024, 50})
+        ->Args({64, 64 * 1024, 0})
+        ->Args({64, 64 * 1024, 90});
+
+    if (const auto *custom = std::getenv("JAG_BENCH_CORPUS"); custom) {
+        std::istringstream in{custom};
+        std::vector<std::int64_t> args{};
+
+        for (std::string arg{}; std::getline(in, arg, ',');) {
+            args.push_back(std::stoll(arg));
+        }
+
+        if (args.size() == 3) {
+            b->Args(args);
+        }
+    }
+}
+
+void data_args(benchmark::internal::Benchmark *b) {
+    b->Args({64 * 1024, 0})
+        ->Args({64 * 1024, 50})
+        ->Args({1024 * 1024, 50})
+        ->Args({1024 * 1024, 90});
+}
+
+std::size_t total_size(const sysd::jag::archive &arc) {
+    std::size_t total{0};
+
+    for (const auto &entry : arc.get_entries()) {
+        total += std::get<sysd::buffer>(entry).data().size();
+    }
+
+    return total;
+}
+
+sysd::jag::serialize_options whole_archive() {
+    sysd::jag::serialize_options opts{};
+    opts.layout = sysd::jag::layout::archive;
+    opts.threshold = 0;
+
+    return opts;
+}
+
+sysd::jag::serialize_options per_entry() {
+    sysd::jag::serialize_options opts{};
+    opts.layout = sysd::jag::layout::entries;
+
+    return opts;
+}
+
+sysd::jag::serialize_options stored() {
+    sysd::jag::serialize_options opts{};
+    opts.threshold = static_cast<std::size_t>(-1);
+
+    return opts;
+}
+
+void BM_encode_entry_name(benchmark::State &state) {
+    std::vector<std::string> names{};
+
+    for (std::size_t i = 0; i < 1024; i++) {
+        names.push_back(bench::entry_name(i));
+    }
+
+    for (auto _ : state) {
+        for (const auto &name : names) {
+            benchmark::DoNotOptimize(
+                sysd::jag::detail::encode_entry_name(name));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_encode_entry_name);
+
+void BM_buffer_write(benchmark::State &state) {
+    const auto count = static_cast<std::size_t>(state.range(0));
+
+    for (auto _ : state) {
+        sysd::buffer buffer{};
+
+        for (std::size_t i = 0; i < count; i++) {
+            buffer.write<4, std::uint32_t>(i);
+            buffer.write<3, std::size_t>(i);
+        }
+
+        benchmark::DoNotOptimize(buffer.data().data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * count * 7);
+}
+BENCHMARK(BM_buffer_write)->Arg(1024)->Arg(64 * 1024);
+
+void BM_buffer_read(benchmark::State &state) {
+    const auto count = static_cast<std::size_t>(state.range(0));
+    sysd::buffer source{};
+
+    for (std::size_t i = 0; i < count; i++) {
+        source.write<4, std::uint32_t>(i);
+        source.write<3, std::size_t>(i);
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto buffer = source;
+        state.ResumeTiming();
+
+        for (std::size_t i = 0; i < count; i++) {
+            benchmark::DoNotOptimize(buffer.read<4, std::uint32_t>());
+            benchmark::DoNotOptimize(buffer.read<3, std::size_t>());
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * count * 7);
+}
+BENCHMARK(BM_buffer_read)->Arg(1024)->Arg(64 * 1024);
+
+void BM_compress(benchmark::State &state) {
+    bench::generator gen{1};
+    const auto data = bench::make_entry(gen, state.range(0), state.range(1));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sysd::jag::detail::compress(data));
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_compress)->Apply(data_args);
+
+void BM_compress_max(benchmark::State &state) {
+    bench::generator gen{1};
+    const auto data = bench::make_entry(gen, state.range(0), state.range(1));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sysd::jag::detail::compress(
+            data, sysd::jag::compression_level::max));
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_compress_max)->Apply(data_args);
+
+void BM_compress_libbz2(benchmark::State &state) {
+    bench::generator gen{1};
+    const auto data = bench::make_entry(gen, state.range(0), state.range(1));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sysd::jag::detail::compress_libbz2(data));
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_compress_libbz2)->Apply(data_args);
+
+void BM_decompress(benchmark::State &state) {
+    bench::generator gen{1};
+    const auto data = bench::make_entry(gen, state.range(0), state.range(1));
+    const auto compressed = sysd::jag::detail::compress(data);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            sysd::jag::detail::decompress(compressed, 0, data.size()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_decompress)->Apply(data_args);
+
+void BM_decompress_libbz2(benchmark::State &state) {
+    bench::generator gen{1};
+    const auto data = bench::make_entry(gen, state.range(0), state.range(1));
+    const auto compressed = sysd::jag::detail::compress(data);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            sysd::jag::detail::decompress_libbz2(compressed, 0, data.size()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_decompress_libbz2)->Apply(data_args);
+
+void BM_likely_compressible(benchmark::State &state) {
+    bench::generator gen{1};
+    const auto data = bench::make_entry(gen, state.range(0), state.range(1));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sysd::jag::detail::likely_compressible(data));
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_likely_compressible)->Apply(data_args);
+
+void BM_crc32(benchmark::State &state) {
+    bench::generator gen{1};
+    const auto data = bench::make_entry(gen, state.range(0), state.range(1));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            sysd::jag::detail::crc32(data.data(), data.size()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_crc32)->Apply(data_args);
+
+void BM_compute_checksum(benchmark::State &state) {
+    bench::generator gen{1};
+    const auto data = bench::make_entry(gen, state.range(0), state.range(1));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sysd::jag::compute_checksum(data));
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_compute_checksum)->Apply(data_args);
+
+void BM_serialize_archive(benchmark::State &state) {
+    const auto arc = bench::make_archive(corpus_of(state));
+    const auto opts = whole_archive();
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sysd::jag::serialize(arc, opts));
+    }
+
+    state.SetBytesProcessed(state.iterations() * total_size(arc));
+}
+BENCHMARK(BM_serialize_archive)->Apply(corpus_args);
+
+void BM_serialize_entries(benchmark::State &state) {
+    const auto arc = bench::make_archive(corpus_of(state));
+    const auto opts = per_entry();
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sysd::jag::serialize(arc, opts));
+    }
+
+    state.SetBytesProcessed(state.iterations() * total_size(arc));
+}
+BENCHMARK(BM_serialize_entries)->Apply(corpus_args);
+
+// unpack_files on its own, by reading an archive with an uncompressed body
+void BM_unpack_files(benchmark::State &state) {
+    const auto arc = bench::make_archive(corpus_of(state));
+    const auto data = sysd::jag::serialize(arc, stored());
+
+    for (auto _ : state) {
+        auto buffer = data;
+        sysd::jag::archive read{buffer};
+
+        benchmark::DoNotOptimize(read.get_entries().data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * total_size(arc));
+}
+BENCHMARK(BM_unpack_files)->Apply(corpus_args);
+
+void BM_read_archive(benchmark::State &state) {
+    const auto arc = bench::make_archive(corpus_of(state));
+    const auto data = sysd::jag::serialize(arc, whole_archive());
+
+    for (auto _ : state) {
+        auto buffer = data;
+        sysd::jag::archive read{buffer};
+
+        benchmark::DoNotOptimize(read.get_entries().data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * total_size(arc));
+}
+BENCHMARK(BM_read_archive)->Apply(corpus_args);
+
+void BM_read_index(benchmark::State &state) {
+    const auto arc = bench::make_archive(corpus_of(state));
+    const auto data = sysd::jag::serialize(arc, whole_archive());
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sysd::jag::read_index(data.data()));
+    }
+}
+BENCHMARK(BM_read_index)->Apply(corpus_args);
+
+void BM_view_first_entry(benchmark::State &state) {
+    const auto arc = bench::make_archive(corpus_of(state));
+    const auto data = sysd::jag::serialize(arc, whole_archive());
+
+    for (auto _ : state) {
+        sysd::jag::archive_view view{data.data()};
+
+        benchmark::DoNotOptimize(view.get(bench::entry_name(0)));
+    }
+}
+BENCHMARK(BM_view_first_entry)->Apply(corpus_args);
+
+// a patch replacing the corpus' first entry, over the whole corpus
+void BM_overlay_flatten(benchmark::State &state) {
+    const auto arc = bench::make_archive(corpus_of(state));
+    const auto base = sysd::jag::serialize(arc, whole_archive());
+
+    sysd::jag::archive patch{};
+    sysd::buffer replacement{std::get<sysd::buffer>(arc.get_entries()[0])};
+    patch.put(bench::entry_name(0), replacement);
+
+    const auto patched = sysd::jag::serialize(patch, whole_archive());
+
+    for (auto _ : state) {
+        sysd::jag::overlay layers{};
+
+        layers.add(sysd::jag::archive_view{base.data()});
+        layers.add(sysd::jag::archive_view{patched.data()});
+
+        benchmark::DoNotOptimize(layers.flatten().get_entries().data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * total_size(arc));
+}
+BENCHMARK(BM_overlay_flatten)->Apply(corpus_args);
+
+// End to end runs of the jag executable, on a corpus written to a scratch
+// directory. These include process start up, and file system costs.
+struct scratch_dir {
+    scratch_dir()
+        : path{boost::filesystem::temp_directory_path() /
+               boost::filesystem::unique_path("jag-bench-%%%%%%%%")} {
+        boost::filesystem::create_directories(path);
+    }
+
+    ~scratch_dir() {
+        boost::system::error_code ec{};
+        boost::filesystem::remove_all(path, ec);
+    }
+
+    boost::filesystem::path path;
+};
+
+void write_to(const boost::filesystem::path &file,
+              const sysd::buffer::container_type &data) {
+    std::ofstream out{file.string(), std::ios::trunc | std::ios::binary};
+    out.write(data.data(), data.size());
+}
+
+void run_jag(benchmark::State &state, const std::string &args) {
+    const auto command =
+        fmt::format("\"{}\" {} > /dev/null", JAG_EXECUTABLE, args);
+
+    if (std::system(command.c_str()) != 0) {
+        state.SkipWithError("jag exited with an error");
+    }
+}
+
+void BM_cli_list(benchmark::State &state) {
+    scratch_dir dir{};
+    const auto file = dir.path / "bench.jag";
+    const auto arc = bench::make_archive(corpus_of(state));
+
+    write_to(file, sysd::jag::serialize(arc, whole_archive()).data());
+
+    for (auto _ : state) {
+        run_jag(state, fmt::format("--list \"{}\"", file.string()));
+    }
+}
+BENCHMARK(BM_cli_list)
+    ->Apply(corpus_args)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+void BM_cli_extract_all(benchmark::State &state) {
+    scratch_dir dir{};
+    const auto file = dir.path / "bench.jag";
+    const auto arc = bench::make_archive(corpus_of(state));
+
+    write_to(file, sysd::jag::serialize(arc, whole_archive()).data());
+
+    for (auto _ : state) {
+        run_jag(state, fmt::format("--extract-all -o \"{}\" \"{}\"",
+                                   dir.path.string(), file.string()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * total_size(arc));
+}
+BENCHMARK(BM_cli_extract_all)
+    ->Apply(corpus_args)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+void BM_cli_sync(benchmark::State &state) {
+    scratch_dir dir{};
+    const auto files = dir.path / "files";
+    const auto arc = bench::make_archive(corpus_of(state));
+
+    boost::filesystem::create_directories(files);
+
+    for (std::size_t i = 0; i < arc.get_entries().size(); i++) {
+        write_to(files / bench::entry_name(i),
+                 std::get<sysd::buffer>(arc.get_entries()[i]).data());
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        boost::filesystem::remove(dir.path / "bench.jag");
+        boost::filesystem::remove(dir.path / "bench.jag.jagidx");
+        state.ResumeTiming();
+
+        run_jag(state, fmt::format("--sync \"{}\" \"{}\"", files.string(),
+                                   (dir.path / "bench.jag").string()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * total_size(arc));
+}
+BENCHMARK(BM_cli_sync)
+    ->Apply(corpus_args)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// indexing a cache directory of 16 archives, each holding the corpus
+void BM_archive_set_index(benchmark::State &state) {
+    scratch_dir dir{};
+    const auto arc = bench::make_archive(corpus_of(state));
+    const auto data = sysd::jag::serialize(arc, whole_archive());
+
+    for (int i = 0; i < 16; i++) {
+        write_to(dir.path / fmt::format("bench{}.jag", i), data.data());
+    }
+
+    for (auto _ : state) {
+        sysd::jag::archive_set set{dir.path};
+
+        benchmark::DoNotOptimize(set.size());
+    }
+}
+BENCHMARK(BM_archive_set_index)
+    ->Apply(corpus_args)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+} // namespace
+
+int main(int argc, char **argv) {
+    spdlog::set_level(spdlog::level::warn);
+    spdlog::stdout_color_mt("jag");
+
+    benchmark::Initialize(&argc, argv);
+
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return 0;
+}
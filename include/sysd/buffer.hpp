@@ -7,6 +7,7 @@
 #include <cstdint>
 #include <iterator>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <spdlog/spdlog.h>
@@ -20,6 +21,7 @@ struct basic_buffer {
     basic_buffer() = default;
     basic_buffer(const std::initializer_list<type> &data) : buf{data} {}
     basic_buffer(const container_type &data) : buf{data} {}
+    basic_buffer(container_type &&data) : buf{std::move(data)} {}
 
     basic_buffer(const basic_buffer &other) = default;
     basic_buffer(basic_buffer &&other) = default;
@@ -32,7 +34,8 @@ struct basic_buffer {
         R result{0};
 
         for (std::size_t i = 0; i < N; i++) {
-            result |= (buf[caret + (N - (i + 1))] & 0xff) << (i * 8);
+            result |= static_cast<R>(buf[caret + (N - (i + 1))] & 0xff)
+                      << (i * 8);
         }
 
         caret += N;
@@ -45,9 +48,10 @@ struct basic_buffer {
         }
     }
 
-    constexpr void write(const basic_buffer &other) {
-        std::copy(std::cbegin(other.data()), std::cend(other.data()),
-                  std::back_inserter(buf));
+    constexpr void write(const basic_buffer &other) { write(other.data()); }
+
+    void write(const container_type &data) {
+        buf.insert(std::end(buf), std::cbegin(data), std::cend(data));
     }
 
     const container_type &data() const { return buf; }
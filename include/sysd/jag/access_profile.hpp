@@ -0,0 +1,67 @@
+#ifndef SYSD_JAG_ACCESS_PROFILE_HPP
+#define SYSD_JAG_ACCESS_PROFILE_HPP
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+#include <boost/utility/string_view.hpp>
+
+#include <sysd/jag/detail/entry_encode.hpp>
+
+namespace sysd::jag {
+// How often each entry of an archive is read, such as gathered from a
+// server's access log. Serializing with a profile lays the entries read most
+// often out first, so they share pages and sit at the front of a compressed
+// body, where decoding them stops soonest.
+struct access_profile {
+    void record(const std::uint32_t name, const std::size_t count = 1) {
+        if (count == 0) {
+            return;
+        }
+
+        auto [it, added] = reads.try_emplace(name, access{0, reads.size()});
+        it->second.count += count;
+    }
+
+    void record(const boost::string_view file, const std::size_t count = 1) {
+        record(detail::encode_entry_name(file), count);
+    }
+
+    std::size_t count(const std::uint32_t name) const {
+        const auto it = reads.find(name);
+        return it == std::end(reads) ? 0 : it->second.count;
+    }
+
+    bool empty() const { return reads.empty(); }
+
+    // whether a belongs before b: it's read more often, or as often but was
+    // recorded first. Entries never read go last.
+    bool hotter(const std::uint32_t a, const std::uint32_t b) const {
+        const auto first = reads.find(a);
+        const auto second = reads.find(b);
+
+        if (first == std::end(reads) || second == std::end(reads)) {
+            return first != std::end(reads) && second == std::end(reads);
+        }
+
+        if (first->second.count != second->second.count) {
+            return first->second.count > second->second.count;
+        }
+
+        return first->second.order < second->second.order;
+    }
+
+  private:
+    struct access {
+        std::size_t count;
+        // the position the entry was first recorded at
+        std::size_t order;
+    };
+
+    std::unordered_map<std::uint32_t, access> reads{};
+};
+} // namespace sysd::jag
+
+#endif // SYSD_JAG_ACCESS_PROFILE_HPP
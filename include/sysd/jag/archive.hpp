@@ -14,8 +14,9 @@
 #include <sysd/buffer.hpp>
 #include <sysd/jag/detail/decompressor.hpp>
 #include <sysd/jag/detail/entry_encode.hpp>
-
-#include <spdlog/spdlog.h>
+#include <sysd/jag/log.hpp>
+#include <sysd/jag/stats.hpp>
+#include <sysd/jag/trace.hpp>
 
 namespace sysd::jag {
 struct archive {
@@ -41,47 +42,114 @@ struct archive {
     }
 
     void put(const boost::string_view file, sysd::buffer &buffer) {
-        auto log = spdlog::get("jag");
-
         const auto encoded = detail::encode_entry_name(file);
 
         for (auto &entry : entries) {
             if (std::get<std::uint32_t>(entry) == encoded) {
-                log->warn("replaced {} in archive", file.to_string());
+                detail::warn("replaced {} in archive", file.to_string());
+
                 std::get<sysd::buffer>(entry) = std::move(buffer);
                 return;
             }
         }
 
-        log->debug("added new archive entry {}", file.to_string());
+        detail::debug("added new archive entry {}", file.to_string());
+
         entries.emplace_back(encoded, std::move(buffer));
     }
 
+    // puts an entry where replacing one is expected, as when syncing, so it
+    // isn't warned about
+    void replace(const boost::string_view file, sysd::buffer &buffer) {
+        const auto found = find(detail::encode_entry_name(file));
+
+        if (found == std::end(entries)) {
+            put(file, buffer);
+            return;
+        }
+
+        std::get<sysd::buffer>(*found) = std::move(buffer);
+
+        detail::debug("replaced {} in archive", file.to_string());
+    }
+
+    // Adds an entry under its encoded name without looking for one to
+    // replace, for building archives whose names are known to be unique.
+    void append(const std::uint32_t name, sysd::buffer &buffer) {
+        entries.emplace_back(name, std::move(buffer));
+    }
+
+    void reserve(const std::size_t count) { entries.reserve(count); }
+
+    bool remove(const boost::string_view file) {
+        const auto encoded = detail::encode_entry_name(file);
+        const auto found = find(encoded);
+
+        if (found == std::end(entries)) {
+            return false;
+        }
+
+        entries.erase(found);
+
+        detail::debug("removed archive entry {}", file.to_string());
+
+        return true;
+    }
+
+    bool rename(const boost::string_view from, const boost::string_view to) {
+        const auto encoded = detail::encode_entry_name(to);
+        const auto found = find(detail::encode_entry_name(from));
+
+        if (found != std::end(entries) &&
+            std::get<std::uint32_t>(*found) == encoded) {
+            return true;
+        }
+
+        if (found == std::end(entries) ||
+            find(encoded) != std::end(entries)) {
+            return false;
+        }
+
+        std::get<std::uint32_t>(*found) = encoded;
+
+        detail::debug("renamed archive entry {} to {}", from.to_string(),
+                      to.to_string());
+
+        return true;
+    }
+
   private:
     std::vector<entry_type> entries{};
 
-    void read_headers(sysd::buffer &buffer) {
-        auto log = spdlog::get("jag");
+    std::vector<entry_type>::iterator find(const std::uint32_t name) {
+        return std::find_if(std::begin(entries), std::end(entries),
+                            [name](const auto &entry) {
+                                return std::get<std::uint32_t>(entry) == name;
+                            });
+    }
 
+    void read_headers(sysd::buffer &buffer) {
         const auto decomp_len = buffer.read<3, std::size_t>();
         const auto comp_len = buffer.read<3, std::size_t>();
 
-        sysd::buffer &decompressed = buffer;
-
-        log->debug("decompressed len={}, compressed len={}", decomp_len,
-                   comp_len);
+        detail::debug("decompressed len={}, compressed len={}", decomp_len,
+                      comp_len);
 
         if (decomp_len != comp_len) {
-            log->debug("decompressing archive");
+            detail::debug("decompressing archive");
 
-            decompressed = sysd::buffer{detail::decompress(
+            // decode into a buffer of our own, rather than clobbering the
+            // caller's copy of the archive
+            sysd::buffer decompressed{detail::decompress(
                 buffer.data(), buffer.position(), decomp_len)};
-        }
 
-        unpack_files(decompressed);
+            unpack_files(decompressed);
+        } else {
+            unpack_files(buffer);
+        }
     }
     void unpack_files(sysd::buffer &buffer) {
-        auto log = spdlog::get("jag");
+        detail::phase_scope scope{phase::unpack, buffer.data().size()};
 
         // The decompressed file format contains a header of 2 bytes for number
         // of files within the archive. Then follows the entry table, for each
@@ -92,7 +160,8 @@ struct archive {
         const auto file_count = buffer.read<2, std::size_t>();
         std::size_t ptr_offset{buffer.position() + (file_count * 10)};
 
-        log->debug("found {} files in archive", file_count);
+        detail::debug("found {} files in archive", file_count);
+        scope.entries(file_count);
 
         entries.reserve(file_count);
 
@@ -101,6 +170,8 @@ struct archive {
             auto decomp_len = buffer.read<3, std::size_t>();
             auto comp_len = buffer.read<3, std::size_t>();
 
+            detail::entry_span span{"unpack", name, decomp_len};
+
             sysd::buffer::container_type entry_data{};
             entry_data.reserve(comp_len);
 
@@ -109,18 +180,20 @@ struct archive {
             std::advance(buff_begin, ptr_offset);
             std::copy_n(buff_begin, comp_len, std::back_inserter(entry_data));
 
-            log->debug("\tname={}, offset={}, size={}", name, ptr_offset,
-                       entry_data.size());
+            detail::debug("\tname={}, offset={}, size={}", name, ptr_offset,
+                          entry_data.size());
 
             if (decomp_len != comp_len) {
-                log->debug("\t\tdecompressing entry");
+                detail::debug("\t\tdecompressing entry");
 
                 auto decompressed =
                     detail::decompress(entry_data, 0, decomp_len);
 
+                scope.bytes_out(decompressed.size());
                 entries.emplace_back(name,
                                      sysd::buffer{std::move(decompressed)});
             } else {
+                scope.bytes_out(entry_data.size());
                 entries.emplace_back(name, sysd::buffer{std::move(entry_data)});
             }
 
@@ -0,0 +1,220 @@
+#ifndef SYSD_JAG_ARCHIVE_HANDLE_HPP
+#define SYSD_JAG_ARCHIVE_HANDLE_HPP
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include <sysd/jag/archive_view.hpp>
+#include <sysd/jag/index.hpp>
+#include <sysd/jag/log.hpp>
+#include <sysd/jag/sidecar.hpp>
+
+namespace sysd::jag {
+// A handle to an archive file which follows the file as it changes, for
+// processes that keep archives open for a long time. The file's directory is
+// watched with inotify, and whenever the file is rewritten or replaced the
+// new version is read and decoded on a background thread, then swapped in.
+//
+// Readers take a snapshot with current() and may hold on to it for as long as
+// they like. A snapshot is fully decoded before it's published so it can be
+// read from any number of threads, it never changes, and it's freed once the
+// last reader lets go of it, so a swap never disturbs a read in flight. A new
+// version which fails to decode, such as one caught half written, is logged
+// and skipped, leaving the last good version in place.
+struct archive_handle {
+    using snapshot = std::shared_ptr<archive_view>;
+
+    // loads the archive, throwing if it can't be, then starts watching it
+    explicit archive_handle(boost::filesystem::path path)
+        : file{boost::filesystem::absolute(path)} {
+        active = load(file);
+        generation = 1;
+
+        notify_fd = inotify_init1(IN_CLOEXEC);
+        stop_fd = eventfd(0, EFD_CLOEXEC);
+
+        if (notify_fd < 0 || stop_fd < 0 ||
+            inotify_add_watch(notify_fd, file.parent_path().c_str(),
+                              IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            const auto error = errno;
+            close_fds();
+
+            throw std::runtime_error{fmt::format(
+                "unable to watch {}: {}", file.string(), std::strerror(error))};
+        }
+
+        watcher = std::thread{[this] { watch(); }};
+    }
+
+    archive_handle(const archive_handle &) = delete;
+    archive_handle &operator=(const archive_handle &) = delete;
+
+    ~archive_handle() {
+        const std::uint64_t stop{1};
+
+        // the watcher also checks the flag every so often, so it stops even
+        // if it can't be woken
+        stopping = true;
+
+        if (::write(stop_fd, &stop, sizeof(stop)) < 0) {
+            detail::warn("unable to wake the watcher of {}", file.string());
+        }
+
+        watcher.join();
+        close_fds();
+    }
+
+    // the latest version of the archive
+    snapshot current() const { return std::atomic_load(&active); }
+
+    // counts up from 1 every time a new version is swapped in
+    std::uint64_t version() const { return generation.load(); }
+
+    // Rereads the file now, rather than waiting to be told it changed.
+    // Returns whether a new version was swapped in, throwing if the file
+    // couldn't be read.
+    bool reload() {
+        std::lock_guard<std::mutex> lock{reload_mutex};
+        auto next = load(file);
+        const auto previous = current();
+
+        if (next->data() == previous->data()) {
+            return false;
+        }
+
+        std::atomic_store(&active, std::move(next));
+        generation++;
+
+        detail::debug("reloaded {}, version {}", file.string(),
+                      generation.load());
+        return true;
+    }
+
+  private:
+    boost::filesystem::path file;
+    snapshot active{};
+    std::atomic<std::uint64_t> generation{0};
+    std::atomic<bool> stopping{false};
+    std::mutex reload_mutex{};
+    int notify_fd{-1};
+    int stop_fd{-1};
+    std::thread watcher{};
+
+    static snapshot load(const boost::filesystem::path &path) {
+        std::ifstream in{path.string(), std::ios::binary};
+
+        if (!in.is_open()) {
+            throw std::runtime_error{
+                fmt::format("unable to open {}", path.string())};
+        }
+
+        detail::container_type data{std::istreambuf_iterator<char>{in},
+                                    std::istreambuf_iterator<char>{}};
+
+        auto view = std::make_shared<archive_view>(
+            open_view(path, std::move(data)));
+        view->decode_body();
+
+        // a stored body isn't decoded, so a file cut short is only caught
+        // by checking the entries fit within it
+        const auto &index = view->index();
+
+        if (view->data().size() !=
+            detail::archive_header_size + index.comp_len) {
+            throw std::runtime_error{
+                fmt::format("{} is truncated", path.string())};
+        }
+
+        for (const auto &entry : index.entries) {
+            if (entry.offset + entry.comp_len > index.decomp_len) {
+                throw std::runtime_error{
+                    fmt::format("entry {:08x} runs past the end of {}",
+                                entry.name, path.string())};
+            }
+        }
+
+        return view;
+    }
+
+    void watch() {
+        // inotify events are variable length, with the name after them
+        alignas(inotify_event) std::array<char, 4096> events{};
+
+        // how long to wait before checking whether to stop, in milliseconds
+        constexpr int stop_check = 1000;
+
+        while (!stopping) {
+            std::array<pollfd, 2> fds{{{notify_fd, POLLIN, 0},
+                                       {stop_fd, POLLIN, 0}}};
+            const auto ready = poll(fds.data(), fds.size(), stop_check);
+
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                detail::warn("stopped watching {}: {}", file.string(),
+                             std::strerror(errno));
+                return;
+            }
+
+            if (ready == 0 || fds[1].revents != 0) {
+                continue;
+            }
+
+            const auto len = ::read(notify_fd, events.data(), events.size());
+            auto changed = false;
+
+            for (auto offset = 0L; offset < len;) {
+                const auto *event =
+                    reinterpret_cast<const inotify_event *>(&events[offset]);
+
+                changed |= event->len > 0 &&
+                           file.filename().string() == event->name;
+                offset += sizeof(inotify_event) + event->len;
+            }
+
+            if (!changed) {
+                continue;
+            }
+
+            try {
+                reload();
+            } catch (const std::exception &e) {
+                detail::warn("keeping the previous version of {}: {}",
+                             file.string(), e.what());
+            }
+        }
+    }
+
+    void close_fds() {
+        if (notify_fd >= 0) {
+            ::close(notify_fd);
+        }
+
+        if (stop_fd >= 0) {
+            ::close(stop_fd);
+        }
+    }
+};
+} // namespace sysd::jag
+
+#endif // SYSD_JAG_ARCHIVE_HANDLE_HPP
@@ -0,0 +1,238 @@
+#ifndef SYSD_JAG_ARCHIVE_SET_HPP
+#define SYSD_JAG_ARCHIVE_SET_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <sysd/buffer.hpp>
+#include <sysd/jag/archive_view.hpp>
+#include <sysd/jag/detail/entry_encode.hpp>
+#include <sysd/jag/detail/parallel.hpp>
+#include <sysd/jag/index.hpp>
+#include <sysd/jag/log.hpp>
+#include <sysd/jag/sidecar.hpp>
+
+namespace sysd::jag {
+// Every .jag archive in a directory, looked up as if they were one. The
+// archives' indexes are read in parallel up front, from their sidecars where
+// those are up to date, and merged into a single table from entry name to the
+// archive holding it. An archive's data is only read the first time one of its
+// entries is, after which it stays open.
+//
+// When more than one archive holds an entry, the one whose path sorts first
+// wins. The set describes the directory as it was when the set was made.
+//
+// Lookups and reads may be made from any number of threads.
+struct archive_set {
+    // where an entry lives
+    struct location {
+        // position of its archive, see archive()
+        std::size_t archive;
+        index_entry entry;
+    };
+
+    explicit archive_set(const boost::filesystem::path &dir,
+                         const std::size_t jobs = detail::default_jobs()) {
+        std::vector<boost::filesystem::path> paths{};
+
+        for (const auto &file : boost::filesystem::directory_iterator{dir}) {
+            if (boost::filesystem::is_regular_file(file.status()) &&
+                file.path().extension() == ".jag") {
+                paths.push_back(file.path());
+            }
+        }
+
+        std::sort(std::begin(paths), std::end(paths));
+
+        for (auto &path : paths) {
+            members.emplace_back(std::move(path));
+        }
+
+        // an archive that can't be indexed is left out, rather than taking
+        // the rest of the directory with it
+        detail::parallel_for(members.size(), jobs, [this](std::size_t i) {
+            try {
+                read_member_index(members[i]);
+            } catch (const std::exception &e) {
+                detail::warn("leaving out {}: {}", members[i].path.string(),
+                             e.what());
+                members[i].index.entries.clear();
+            }
+        });
+
+        std::size_t total{0};
+
+        for (const auto &member : members) {
+            total += member.index.entries.size();
+        }
+
+        table.reserve(total);
+
+        for (std::size_t i = 0; i < members.size(); i++) {
+            for (const auto &entry : members[i].index.entries) {
+                table.emplace(entry.name, location{i, entry});
+            }
+        }
+
+        detail::debug("indexed {} entries across {} archives in {}, {} "
+                      "shadowed",
+                      table.size(), members.size(), dir.string(),
+                      total - table.size());
+    }
+
+    archive_set(const archive_set &) = delete;
+    archive_set &operator=(const archive_set &) = delete;
+
+    // the number of distinct entries across every archive
+    std::size_t size() const { return table.size(); }
+
+    std::size_t archive_count() const { return members.size(); }
+
+    const boost::filesystem::path &archive(std::size_t i) const {
+        return members[i].path;
+    }
+
+    boost::optional<const location &>
+    find(const boost::string_view file) const {
+        return find(detail::encode_entry_name(file));
+    }
+
+    boost::optional<const location &> find(const std::uint32_t name) const {
+        if (auto it = table.find(name); it != std::end(table)) {
+            return it->second;
+        }
+
+        return boost::none;
+    }
+
+    boost::optional<sysd::buffer> get(const boost::string_view file) {
+        return get(detail::encode_entry_name(file));
+    }
+
+    boost::optional<sysd::buffer> get(const std::uint32_t name) {
+        if (auto loc = find(name); loc) {
+            return read(loc.value());
+        }
+
+        return boost::none;
+    }
+
+    sysd::buffer read(const location &loc) {
+        auto &m = members[loc.archive];
+        auto &view = open(m);
+
+        if (!m.reindexed) {
+            return view.read(loc.entry);
+        }
+
+        // the table's copy of the entry came from a stale index
+        if (auto entry = view.find(loc.entry.name); entry) {
+            return view.read(entry.value());
+        }
+
+        throw std::runtime_error{
+            fmt::format("{} no longer holds entry {:08x}", m.path.string(),
+                        loc.entry.name)};
+    }
+
+  private:
+    struct member {
+        explicit member(boost::filesystem::path file)
+            : path{std::move(file)} {}
+
+        boost::filesystem::path path;
+        archive_index index{};
+        // the sidecar the index came from, if it did
+        boost::optional<sidecar> side{};
+        // whether the index turned out to be stale once opened
+        bool reindexed{false};
+        std::once_flag opened{};
+        std::unique_ptr<archive_view> view{};
+    };
+
+    // a deque, since members can't be moved once their views may be opening
+    std::deque<member> members{};
+    std::unordered_map<std::uint32_t, location> table{};
+
+    static detail::container_type
+    read_member_data(const boost::filesystem::path &path) {
+        std::ifstream in{path.string(), std::ios::binary};
+
+        if (!in.is_open()) {
+            throw std::runtime_error{
+                fmt::format("unable to open {}", path.string())};
+        }
+
+        return detail::container_type{std::istreambuf_iterator<char>{in},
+                                      std::istreambuf_iterator<char>{}};
+    }
+
+    static bool same_entries(const archive_index &a, const archive_index &b) {
+        return std::equal(
+            std::begin(a.entries), std::end(a.entries), std::begin(b.entries),
+            std::end(b.entries), [](const auto &x, const auto &y) {
+                return x.name == y.name && x.offset == y.offset &&
+                       x.decomp_len == y.decomp_len &&
+                       x.comp_len == y.comp_len;
+            });
+    }
+
+    static void read_member_index(member &m) {
+        if (auto side = read_sidecar(sidecar_path(m.path));
+            side && side->matches(m.path)) {
+            m.index = side->to_index();
+            m.side = std::move(side);
+            return;
+        }
+
+        m.index = read_index(read_member_data(m.path));
+    }
+
+    // Reads and fully decodes the member's archive on first use, so its view
+    // can be shared between threads from then on. A failed open is retried
+    // by the next read.
+    archive_view &open(member &m) {
+        std::call_once(m.opened, [&m] {
+            auto data = read_member_data(m.path);
+
+            // A sidecar is only matched by size and mtime while indexing,
+            // which a quick rewrite of the same size gets past, so it must
+            // also describe the data actually read. Without one, the index
+            // is read again from the data, which the view decoding the
+            // body would have to start on anyway.
+            const auto trusted = m.side && m.side->describes(data);
+
+            auto view = std::make_unique<archive_view>(
+                std::move(data), trusted ? boost::make_optional(m.index)
+                                         : boost::none);
+            view->decode_body();
+
+            if (!trusted && !same_entries(view->index(), m.index)) {
+                detail::debug("{} changed since it was indexed",
+                              m.path.string());
+                m.index = view->index();
+                m.reindexed = true;
+            }
+
+            m.view = std::move(view);
+        });
+
+        return *m.view;
+    }
+};
+} // namespace sysd::jag
+
+#endif // SYSD_JAG_ARCHIVE_SET_HPP
@@ -0,0 +1,134 @@
+#ifndef SYSD_JAG_ARCHIVE_VIEW_HPP
+#define SYSD_JAG_ARCHIVE_VIEW_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <sysd/buffer.hpp>
+#include <sysd/jag/detail/decompressor.hpp>
+#include <sysd/jag/detail/entry_encode.hpp>
+#include <sysd/jag/index.hpp>
+#include <sysd/jag/trace.hpp>
+
+namespace sysd::jag {
+// A read-only view of an archive which only decodes what it is asked for.
+// Unlike archive, opening a view reads just the entry table. When the whole
+// archive is compressed, its body is decoded incrementally and only as far as
+// the end of the furthest entry requested so far, so looking up an entry
+// costs in proportion to its position rather than to the archive's size.
+//
+// A view isn't safe to share between threads without external locking, until
+// decode_body() has been called. From then on nothing is decoded lazily and
+// entries may be read concurrently.
+struct archive_view {
+    using container_type = detail::container_type;
+
+    archive_view(container_type data)
+        : archive_view{std::move(data), boost::none} {}
+
+    // opens a view with an index that's already known, such as one loaded
+    // from a sidecar, so the entry table doesn't have to be parsed again
+    archive_view(container_type data, boost::optional<archive_index> known)
+        : raw{std::move(data)} {
+        // reading the index decodes the start of a compressed body, which
+        // the view carries on from rather than decoding it again
+        if (known) {
+            idx = std::move(known.value());
+        } else {
+            idx = detail::read_index(raw, decoder);
+        }
+
+        if (idx.compressed() && !decoder) {
+            decoder = std::make_unique<detail::partial_decompressor>(
+                raw, detail::archive_header_size, idx.decomp_len);
+        }
+    }
+
+    archive_view(const archive_view &) = delete;
+    archive_view(archive_view &&) = default;
+    archive_view &operator=(const archive_view &) = delete;
+    archive_view &operator=(archive_view &&) = default;
+
+    const archive_index &index() const { return idx; }
+
+    // the archive as it was read
+    const container_type &data() const { return raw; }
+
+    void decode_body() {
+        if (decoder) {
+            decoder->decode_all();
+        }
+    }
+
+    boost::optional<const index_entry &>
+    find(const boost::string_view file) const {
+        return find(detail::encode_entry_name(file));
+    }
+
+    boost::optional<const index_entry &> find(const std::uint32_t name) const {
+        for (const auto &entry : idx.entries) {
+            if (entry.name == name) {
+                return entry;
+            }
+        }
+
+        return boost::none;
+    }
+
+    boost::optional<sysd::buffer> get(const boost::string_view file) {
+        return get(detail::encode_entry_name(file));
+    }
+
+    boost::optional<sysd::buffer> get(const std::uint32_t name) {
+        if (auto entry = find(name); entry) {
+            return read(entry.value());
+        }
+
+        return boost::none;
+    }
+
+    sysd::buffer read(const index_entry &entry) {
+        detail::entry_span span{"read", entry.name, entry.decomp_len};
+        auto packed = packed_data(entry);
+
+        if (entry.compressed()) {
+            return sysd::buffer{
+                detail::decompress(packed, 0, entry.decomp_len)};
+        }
+
+        return sysd::buffer{std::move(packed)};
+    }
+
+    // the entry's data as it is stored in the body, still compressed if the
+    // entry was compressed on its own
+    container_type packed_data(const index_entry &entry) {
+        const auto end = entry.offset + entry.comp_len;
+
+        const auto &body = decoder ? decoder->decode_until(end) : raw;
+        const auto body_offset = decoder ? 0 : detail::archive_header_size;
+
+        if (body.size() < body_offset + end) {
+            throw std::runtime_error{"archive entry data is truncated"};
+        }
+
+        auto begin = std::cbegin(body);
+        std::advance(begin, body_offset + entry.offset);
+
+        return container_type(begin, begin + entry.comp_len);
+    }
+
+  private:
+    container_type raw;
+    archive_index idx{};
+    std::unique_ptr<detail::partial_decompressor> decoder{};
+};
+} // namespace sysd::jag
+
+#endif // SYSD_JAG_ARCHIVE_VIEW_HPP
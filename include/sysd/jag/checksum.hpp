@@ -0,0 +1,177 @@
+#ifndef SYSD_JAG_CHECKSUM_HPP
+#define SYSD_JAG_CHECKSUM_HPP
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <sysd/jag/archive_view.hpp>
+#include <sysd/jag/detail/crc32.hpp>
+#include <sysd/jag/detail/sha256.hpp>
+
+namespace sysd::jag {
+// What an update server advertises about a file: its size, CRC-32 and
+// SHA-256.
+struct checksum {
+    std::size_t size{0};
+    std::uint32_t crc{0};
+    detail::sha256::digest_type sha256{};
+};
+
+bool operator==(const checksum &a, const checksum &b) {
+    return a.size == b.size && a.crc == b.crc && a.sha256 == b.sha256;
+}
+
+bool operator!=(const checksum &a, const checksum &b) { return !(a == b); }
+
+// Checksums data as it goes by, in as many pieces as it comes in.
+struct checksummer {
+    void update(const char *data, std::size_t len) {
+        sum.size += len;
+        sum.crc = detail::crc32(data, len, sum.crc);
+        hash.update(data, len);
+    }
+
+    void update(const detail::container_type &data) {
+        update(data.data(), data.size());
+    }
+
+    checksum finish() {
+        sum.sha256 = hash.finish();
+        return sum;
+    }
+
+  private:
+    checksum sum{};
+    detail::sha256 hash{};
+};
+
+checksum compute_checksum(const detail::container_type &data) {
+    checksummer sums{};
+    sums.update(data);
+
+    return sums.finish();
+}
+
+struct entry_checksum {
+    std::uint32_t name;
+    // of the entry's decompressed data
+    jag::checksum checksum;
+};
+
+// the checksums of an archive file and its entries, in table order
+struct archive_checksums {
+    checksum archive{};
+    std::vector<entry_checksum> entries{};
+};
+
+// Checksums the archive a view was opened on, decoding each of its entries.
+archive_checksums read_checksums(archive_view &view) {
+    archive_checksums sums{};
+
+    sums.archive = compute_checksum(view.data());
+    sums.entries.reserve(view.index().entries.size());
+
+    for (const auto &entry : view.index().entries) {
+        sums.entries.push_back(
+            {entry.name, compute_checksum(view.read(entry).data())});
+    }
+
+    return sums;
+}
+
+// Writes one line per file checksummed, the archive's followed by each of
+// its entries', which are named <archive>:<entry name hash>:
+//
+//   <crc32> <sha256> <size> <file>
+void write_checksums(std::ostream &out, const std::string &archive,
+                     const archive_checksums &sums) {
+    const auto line = [&out](const checksum &sum, const std::string &file) {
+        fmt::MemoryWriter hex{};
+
+        for (const auto byte : sum.sha256) {
+            hex.write("{:02x}", byte);
+        }
+
+        out << fmt::format("{:08x} {} {} {}\n", sum.crc, hex.str(), sum.size,
+                           file);
+    };
+
+    line(sums.archive, archive);
+
+    for (const auto &entry : sums.entries) {
+        line(entry.checksum, fmt::format("{}:{:08x}", archive, entry.name));
+    }
+}
+
+// checksums read back from what write_checksums() wrote, by file
+using checksum_manifest = std::unordered_map<std::string, checksum>;
+
+checksum_manifest read_checksum_manifest(std::istream &in) {
+    const auto hex_digit = [](const char c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+
+        throw std::runtime_error{"malformed checksum"};
+    };
+
+    checksum_manifest manifest{};
+    std::size_t line_no{0};
+
+    for (std::string line{}; std::getline(in, line);) {
+        line_no++;
+
+        if (line.empty()) {
+            continue;
+        }
+
+        checksum sum{};
+        const auto crc_end = line.find(' ');
+        const auto sha_end = line.find(' ', crc_end + 1);
+        const auto size_end = line.find(' ', sha_end + 1);
+
+        if (crc_end != 8 || sha_end != crc_end + 1 + sum.sha256.size() * 2 ||
+            size_end == std::string::npos || size_end + 1 == line.size()) {
+            throw std::runtime_error{
+                fmt::format("line {}: malformed checksum", line_no)};
+        }
+
+        try {
+            for (std::size_t i = 0; i < crc_end; i++) {
+                sum.crc = (sum.crc << 4) | hex_digit(line[i]);
+            }
+
+            for (std::size_t i = 0; i < sum.sha256.size(); i++) {
+                const auto at = crc_end + 1 + i * 2;
+                sum.sha256[i] = static_cast<std::uint8_t>(
+                    hex_digit(line[at]) << 4 | hex_digit(line[at + 1]));
+            }
+
+            sum.size = std::stoull(
+                line.substr(sha_end + 1, size_end - sha_end - 1));
+        } catch (const std::exception &) {
+            throw std::runtime_error{
+                fmt::format("line {}: malformed checksum", line_no)};
+        }
+
+        manifest[line.substr(size_end + 1)] = sum;
+    }
+
+    return manifest;
+}
+} // namespace sysd::jag
+
+#endif // SYSD_JAG_CHECKSUM_HPP
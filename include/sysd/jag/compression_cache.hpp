@@ -0,0 +1,142 @@
+#ifndef SYSD_JAG_COMPRESSION_CACHE_HPP
+#define SYSD_JAG_COMPRESSION_CACHE_HPP
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+
+#include <sysd/buffer.hpp>
+#include <sysd/jag/detail/compressor.hpp>
+#include <sysd/jag/detail/hash.hpp>
+#include <sysd/jag/log.hpp>
+
+namespace sysd::jag {
+// An on-disk cache of compressed payloads, keyed by the content hash of the
+// uncompressed input and the codec parameters. Each cached payload lives in
+// its own file named after the key, prefixed by a small header:
+//
+//   4 bytes magic, 8 bytes content hash, 4 bytes input length
+//
+// The header is checked on every hit so a truncated file or a hash collision
+// on inputs of a different length is treated as a miss instead of producing
+// a corrupt archive.
+struct compression_cache {
+    using container_type = detail::container_type;
+
+    static constexpr std::uint32_t magic = 0x4a414743; // "JAGC"
+    static constexpr std::size_t header_size = 16;
+
+    explicit compression_cache(const boost::filesystem::path &dir)
+        : directory{dir} {
+        boost::filesystem::create_directories(directory);
+    }
+
+    container_type
+    compress(const container_type &data,
+             compression_level level = compression_level::normal) {
+        const auto *params = detail::codec_params(level);
+        const auto seed = detail::content_hash(params, std::strlen(params));
+        const auto key = detail::content_hash(data, seed);
+        const auto file = path_of(key);
+
+        if (auto cached = load(file, key, data.size()); cached) {
+            hit_count++;
+            return std::move(cached.value());
+        }
+
+        miss_count++;
+
+        auto compressed = detail::compress(data, level);
+        store(file, key, data.size(), compressed);
+
+        return compressed;
+    }
+
+    std::size_t hits() const { return hit_count; }
+    std::size_t misses() const { return miss_count; }
+
+  private:
+    boost::filesystem::path directory;
+    std::size_t hit_count{0};
+    std::size_t miss_count{0};
+
+    boost::filesystem::path path_of(std::uint64_t key) const {
+        return directory / fmt::format("{:016x}.bz", key);
+    }
+
+    boost::optional<container_type> load(const boost::filesystem::path &file,
+                                         std::uint64_t key,
+                                         std::size_t length) const {
+        std::ifstream in{file.string(), std::ios::binary};
+
+        if (!in.is_open()) {
+            return boost::none;
+        }
+
+        container_type data{std::istreambuf_iterator<char>{in},
+                            std::istreambuf_iterator<char>{}};
+
+        if (data.size() < header_size) {
+            return boost::none;
+        }
+
+        sysd::buffer header{container_type{std::begin(data),
+                                            std::begin(data) + header_size}};
+
+        if (header.read<4, std::uint32_t>() != magic ||
+            header.read<8, std::uint64_t>() != key ||
+            header.read<4, std::size_t>() != length) {
+            return boost::none;
+        }
+
+        data.erase(std::begin(data), std::begin(data) + header_size);
+
+        return data;
+    }
+
+    void store(const boost::filesystem::path &file, std::uint64_t key,
+               std::size_t length, const container_type &compressed) const {
+        sysd::buffer header{};
+
+        header.write<4, std::uint32_t>(magic);
+        header.write<8, std::uint64_t>(key);
+        header.write<4, std::size_t>(length);
+
+        // write to a temporary file first so a concurrent build, or one
+        // that's interrupted, never observes a partially written payload
+        auto tmp = file;
+        tmp += boost::filesystem::unique_path(".%%%%%%%%.tmp");
+
+        {
+            std::ofstream out{tmp.string(),
+                              std::ios::trunc | std::ios::binary};
+
+            out.write(header.data().data(), header.data().size());
+            out.write(compressed.data(), compressed.size());
+
+            if (!out) {
+                detail::warn("unable to write cache entry {}", tmp.string());
+
+                boost::system::error_code ec{};
+                boost::filesystem::remove(tmp, ec);
+                return;
+            }
+        }
+
+        boost::system::error_code ec{};
+        boost::filesystem::rename(tmp, file, ec);
+
+        if (ec) {
+            boost::filesystem::remove(tmp, ec);
+        }
+    }
+};
+} // namespace sysd::jag
+
+#endif // SYSD_JAG_COMPRESSION_CACHE_HPP
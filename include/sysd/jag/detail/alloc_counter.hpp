@@ -0,0 +1,33 @@
+#ifndef SYSD_JAG_ALLOC_COUNTER_HPP
+#define SYSD_JAG_ALLOC_COUNTER_HPP
+
+#pragma once
+
+#include <cstdint>
+
+namespace sysd::jag::detail {
+// Whether the program was built with allocation tracking, in which case
+// global operator new is replaced by one that counts every allocation made on
+// the calling thread. See src/alloc_tracking.cpp.
+#ifdef SYSD_JAG_TRACK_ALLOCATIONS
+constexpr bool tracking_allocations = true;
+#else
+constexpr bool tracking_allocations = false;
+#endif
+
+struct alloc_counts {
+    std::uint64_t count;
+    std::uint64_t bytes;
+};
+
+// Per-thread, so a phase can attribute allocations to itself by comparing
+// the counts at its start and end, even while other threads allocate. This
+// is inline, unlike most of the library, as the replaced operator new lives
+// in a translation unit of its own.
+inline alloc_counts &thread_alloc_counts() {
+    thread_local alloc_counts counts{0, 0};
+    return counts;
+}
+} // namespace sysd::jag::detail
+
+#endif // SYSD_JAG_ALLOC_COUNTER_HPP
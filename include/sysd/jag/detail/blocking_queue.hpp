@@ -0,0 +1,73 @@
+#ifndef SYSD_JAG_BLOCKING_QUEUE_HPP
+#define SYSD_JAG_BLOCKING_QUEUE_HPP
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include <boost/optional.hpp>
+
+namespace sysd::jag::detail {
+// A bounded multi-producer multi-consumer queue used to connect the stages of
+// a pipeline. Producers block while the queue is full, which keeps a fast
+// stage from buffering an entire archive in front of a slow one. Once closed,
+// consumers drain what is left and then receive boost::none.
+template <typename T> struct blocking_queue {
+    explicit blocking_queue(std::size_t capacity) : capacity{capacity} {}
+
+    blocking_queue(const blocking_queue &) = delete;
+    blocking_queue &operator=(const blocking_queue &) = delete;
+
+    bool push(T value) {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        not_full.wait(lock,
+                      [this] { return closed || items.size() < capacity; });
+
+        if (closed) {
+            return false;
+        }
+
+        items.push_back(std::move(value));
+        not_empty.notify_one();
+
+        return true;
+    }
+
+    boost::optional<T> pop() {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        not_empty.wait(lock, [this] { return closed || !items.empty(); });
+
+        if (items.empty()) {
+            return boost::none;
+        }
+
+        T value = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+
+        return value;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+  private:
+    std::size_t capacity;
+    std::deque<T> items{};
+    std::mutex mutex{};
+    std::condition_variable not_empty{};
+    std::condition_variable not_full{};
+    bool closed{false};
+};
+} // namespace sysd::jag::detail
+
+#endif // SYSD_JAG_BLOCKING_QUEUE_HPP
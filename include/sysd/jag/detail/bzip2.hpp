@@ -0,0 +1,1253 @@
+#ifndef SYSD_JAG_BZIP2_HPP
+#define SYSD_JAG_BZIP2_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <sysd/jag/detail/suffix_array.hpp>
+
+namespace sysd::jag {
+// How hard compression works for a smaller result. Either way the output is
+// an ordinary bzip2 stream.
+enum class compression_level { normal, max };
+} // namespace sysd::jag
+
+namespace sysd::jag::detail {
+namespace bzip2 {
+// jag only ever uses a block size of 1, a block holds at most 100k bytes
+constexpr std::size_t max_block_size = 100000;
+constexpr std::size_t max_groups = 6;
+constexpr std::size_t max_alpha_size = 258;
+constexpr std::size_t max_code_length = 20;
+constexpr std::size_t max_selectors = 18002;
+constexpr std::size_t group_size = 50;
+
+constexpr std::uint64_t block_magic = 0x314159265359;
+constexpr std::uint64_t end_magic = 0x177245385090;
+
+// bits looked up at once when decoding huffman codes
+constexpr unsigned lookup_bits = 10;
+
+// bzip2's crc is the big endian (unreflected) CRC-32
+constexpr auto crc_table = [] {
+    std::array<std::uint32_t, 256> table{};
+
+    for (std::uint32_t i = 0; i < 256; i++) {
+        auto crc = i << 24;
+
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+        }
+
+        table[i] = crc;
+    }
+
+    return table;
+}();
+
+std::uint32_t block_crc(const char *data, std::size_t len) {
+    std::uint32_t crc{0xffffffff};
+
+    for (std::size_t i = 0; i < len; i++) {
+        crc = (crc << 8) ^
+              crc_table[(crc >> 24) ^ static_cast<unsigned char>(data[i])];
+    }
+
+    return ~crc;
+}
+
+// Reads bits most significant first, keeping up to 64 of them buffered and
+// left aligned so peeking is a single shift.
+struct bit_reader {
+    bit_reader(const char *data, std::size_t size)
+        : pos{reinterpret_cast<const unsigned char *>(data)}, end{pos + size} {
+        refill();
+    }
+
+    // keeps at least 56 bits buffered, past the end of the data zeros are
+    // read instead and counted so overruns can be detected
+    void refill() {
+        while (count <= 56) {
+            std::uint64_t byte{0};
+
+            if (pos != end) {
+                byte = *pos++;
+            } else {
+                padding++;
+            }
+
+            bits |= byte << (56 - count);
+            count += 8;
+        }
+    }
+
+    std::uint32_t peek(unsigned n) const {
+        return static_cast<std::uint32_t>(bits >> (64 - n));
+    }
+
+    void consume(unsigned n) {
+        bits <<= n;
+        count -= n;
+    }
+
+    // n must be between 1 and 32
+    std::uint32_t read(unsigned n) {
+        if (count < n) {
+            refill();
+        }
+
+        const auto value = peek(n);
+        consume(n);
+        return value;
+    }
+
+    bool overrun() const { return padding * 8 > count; }
+
+  private:
+    const unsigned char *pos;
+    const unsigned char *end;
+    std::uint64_t bits{0};
+    unsigned count{0};
+    unsigned padding{0};
+};
+
+// A canonical huffman code, decoded through a lookup table indexed by the
+// next lookup_bits bits of input. Each slot decodes up to two symbols at
+// once when both of their codes fit, longer codes fall back to a search over
+// the code lengths.
+struct huffman_table {
+    void build(const std::uint8_t *lengths, std::size_t alpha_size,
+               std::uint16_t end_of_block) {
+        std::array<std::uint32_t, max_code_length + 2> counts{};
+
+        min_length = max_code_length;
+        max_length = 0;
+
+        for (std::size_t i = 0; i < alpha_size; i++) {
+            counts[lengths[i]]++;
+            min_length = std::min<unsigned>(min_length, lengths[i]);
+            max_length = std::max<unsigned>(max_length, lengths[i]);
+        }
+
+        // symbols ordered by code length, then by symbol
+        std::array<std::uint32_t, max_code_length + 2> offsets{};
+
+        for (std::size_t len = 1; len <= max_code_length; len++) {
+            offsets[len + 1] = offsets[len] + counts[len];
+        }
+
+        for (std::size_t i = 0; i < alpha_size; i++) {
+            perm[offsets[lengths[i]]++] = static_cast<std::uint16_t>(i);
+        }
+
+        std::int32_t code{0};
+        std::uint32_t index{0};
+
+        for (std::size_t len = 1; len <= max_code_length; len++) {
+            base[len] = code - static_cast<std::int32_t>(index);
+            code += counts[len];
+            index += counts[len];
+            limit[len] = code - 1;
+
+            if (code > (1 << len)) {
+                throw std::runtime_error{
+                    "corrupt bzip2 stream: oversubscribed huffman code"};
+            }
+
+            code <<= 1;
+        }
+
+        // one symbol per slot first
+        std::fill(std::begin(lookup), std::end(lookup), 0);
+        index = 0;
+
+        for (std::size_t len = 1; len <= max_code_length; len++) {
+            for (std::uint32_t i = 0; i < counts[len]; i++, index++) {
+                if (len > lookup_bits) {
+                    continue;
+                }
+
+                const auto symbol = perm[index];
+                const auto first = static_cast<std::uint32_t>(
+                                       base[len] + static_cast<int>(index))
+                                   << (lookup_bits - len);
+                const auto last = first + (1u << (lookup_bits - len));
+
+                for (auto slot = first; slot < last; slot++) {
+                    lookup[slot] = pack(symbol, 0, len, len, 1);
+                }
+            }
+        }
+
+        // then pair each symbol with the one following it, if its code fits
+        // in the remaining bits. Nothing follows the end of a block.
+        const auto single = lookup;
+
+        for (std::uint32_t slot = 0; slot < lookup.size(); slot++) {
+            const auto first = single[slot];
+            const auto first_len = length(first);
+
+            if (count(first) == 0 || symbol(first) == end_of_block) {
+                continue;
+            }
+
+            const auto second =
+                single[(slot << first_len) & (lookup.size() - 1)];
+
+            if (count(second) > 0 &&
+                first_len + length(second) <= lookup_bits) {
+                lookup[slot] =
+                    pack(symbol(first), symbol(second), first_len,
+                         first_len + length(second), 2);
+            }
+        }
+    }
+
+    // decodes a symbol whose code is too long for the lookup table
+    std::uint16_t decode_slow(bit_reader &bits) const {
+        for (auto len = std::max(min_length, lookup_bits + 1);
+             len <= max_length; len++) {
+            const auto code = static_cast<std::int32_t>(bits.peek(len));
+
+            if (code <= limit[len]) {
+                bits.consume(len);
+                return perm[code - base[len]];
+            }
+        }
+
+        throw std::runtime_error{"corrupt bzip2 stream: bad huffman code"};
+    }
+
+    // a slot holds two 9 bit symbols, the length of the first symbol's
+    // code, the length of both codes and how many symbols were decoded
+    static constexpr std::uint32_t pack(std::uint32_t first,
+                                        std::uint32_t second,
+                                        std::uint32_t first_len,
+                                        std::uint32_t total_len,
+                                        std::uint32_t count) {
+        return first | (second << 9) | (first_len << 18) | (total_len << 23) |
+               (count << 28);
+    }
+
+    static constexpr std::uint16_t symbol(std::uint32_t slot) {
+        return slot & 0x1ff;
+    }
+    static constexpr std::uint16_t second_symbol(std::uint32_t slot) {
+        return (slot >> 9) & 0x1ff;
+    }
+    static constexpr unsigned length(std::uint32_t slot) {
+        return (slot >> 18) & 0x1f;
+    }
+    static constexpr unsigned total_length(std::uint32_t slot) {
+        return (slot >> 23) & 0x1f;
+    }
+    static constexpr unsigned count(std::uint32_t slot) { return slot >> 28; }
+
+    std::array<std::uint32_t, 1u << lookup_bits> lookup{};
+
+  private:
+    std::array<std::int32_t, max_code_length + 2> limit{};
+    std::array<std::int32_t, max_code_length + 2> base{};
+    std::array<std::uint16_t, max_alpha_size> perm{};
+    unsigned min_length{0};
+    unsigned max_length{0};
+};
+} // namespace bzip2
+
+// Decodes the bzip2 streams jag uses, which have their "BZh1" header stripped
+// and so always use 100k blocks, one block at a time. Every block's crc, and
+// the stream's combined crc, are checked.
+struct bzip2_decoder {
+    bzip2_decoder(const char *data, std::size_t size)
+        : bits{data, size}, tt(bzip2::max_block_size) {}
+
+    bzip2_decoder(const bzip2_decoder &) = delete;
+    bzip2_decoder &operator=(const bzip2_decoder &) = delete;
+
+    bool finished() const { return done; }
+
+    // Appends the next block's data to out, returning false once the end of
+    // the stream has been reached instead.
+    bool decode_block(std::vector<char> &out) {
+        if (done) {
+            return false;
+        }
+
+        const auto magic =
+            (static_cast<std::uint64_t>(bits.read(24)) << 24) | bits.read(24);
+
+        if (magic == bzip2::end_magic) {
+            const auto expected = bits.read(32);
+
+            if (bits.overrun()) {
+                throw std::runtime_error{"truncated bzip2 stream"};
+            }
+
+            if (expected != combined_crc) {
+                throw std::runtime_error{"bzip2 stream crc mismatch"};
+            }
+
+            done = true;
+            return false;
+        }
+
+        if (magic != bzip2::block_magic) {
+            throw std::runtime_error{"corrupt bzip2 stream: bad block magic"};
+        }
+
+        const auto expected = bits.read(32);
+
+        if (bits.read(1) != 0) {
+            throw std::runtime_error{
+                "unsupported bzip2 stream: randomised block"};
+        }
+
+        const auto orig_ptr = bits.read(24);
+        const auto length = read_block();
+
+        if (bits.overrun()) {
+            throw std::runtime_error{"truncated bzip2 stream"};
+        }
+
+        if (orig_ptr >= length) {
+            throw std::runtime_error{"corrupt bzip2 stream: bad origin"};
+        }
+
+        const auto start = out.size();
+
+        inverse_bwt(orig_ptr, length, out);
+
+        if (bzip2::block_crc(out.data() + start, out.size() - start) !=
+            expected) {
+            throw std::runtime_error{"bzip2 block crc mismatch"};
+        }
+
+        combined_crc = ((combined_crc << 1) | (combined_crc >> 31)) ^ expected;
+        return true;
+    }
+
+  private:
+    bzip2::bit_reader bits;
+    // each entry holds a byte of the block in its low 8 bits, and once
+    // the block is decoded, the index of the next entry in its high 24 bits,
+    // so following the transform touches a single array
+    std::vector<std::uint32_t> tt;
+    std::array<bzip2::huffman_table, bzip2::max_groups> tables{};
+    std::array<std::uint8_t, bzip2::max_selectors> selectors{};
+    std::array<std::uint32_t, 256> counts{};
+    std::uint32_t combined_crc{0};
+    bool done{false};
+
+    // reads a block's tables and undoes its huffman, move to front and
+    // zero run length coding into tt, returning the block's length
+    std::size_t read_block() {
+        // the bytes present in the block, in order
+        std::array<std::uint8_t, 256> seq_to_unseq{};
+        std::size_t in_use{0};
+        const auto used = bits.read(16);
+
+        for (unsigned i = 0; i < 16; i++) {
+            if ((used & (0x8000 >> i)) == 0) {
+                continue;
+            }
+
+            const auto group = bits.read(16);
+
+            for (unsigned j = 0; j < 16; j++) {
+                if (group & (0x8000 >> j)) {
+                    seq_to_unseq[in_use++] =
+                        static_cast<std::uint8_t>(i * 16 + j);
+                }
+            }
+        }
+
+        if (in_use == 0) {
+            throw std::runtime_error{"corrupt bzip2 stream: empty block"};
+        }
+
+        const auto alpha_size = in_use + 2;
+        const auto end_of_block = static_cast<std::uint16_t>(in_use + 1);
+        const auto group_count = bits.read(3);
+        const auto selector_count = bits.read(15);
+
+        if (group_count < 2 || group_count > bzip2::max_groups ||
+            selector_count == 0) {
+            throw std::runtime_error{"corrupt bzip2 stream: bad tables"};
+        }
+
+        // selectors are move to front coded in unary, like libbz2 any beyond
+        // the maximum a valid encoder writes are read and ignored
+        std::array<std::uint8_t, bzip2::max_groups> order{0, 1, 2, 3, 4, 5};
+
+        for (std::uint32_t i = 0; i < selector_count; i++) {
+            unsigned j{0};
+
+            while (bits.read(1)) {
+                if (++j >= group_count) {
+                    throw std::runtime_error{
+                        "corrupt bzip2 stream: bad selector"};
+                }
+            }
+
+            const auto group = order[j];
+
+            std::memmove(order.data() + 1, order.data(), j);
+            order[0] = group;
+
+            if (i < bzip2::max_selectors) {
+                selectors[i] = group;
+            }
+        }
+
+        const auto usable_selectors =
+            std::min<std::size_t>(selector_count, bzip2::max_selectors);
+
+        // code lengths are delta coded from a 5 bit starting length
+        for (std::uint32_t t = 0; t < group_count; t++) {
+            std::array<std::uint8_t, bzip2::max_alpha_size> lengths{};
+            auto length = bits.read(5);
+
+            for (std::size_t i = 0; i < alpha_size; i++) {
+                while (true) {
+                    if (length < 1 || length > bzip2::max_code_length) {
+                        throw std::runtime_error{
+                            "corrupt bzip2 stream: bad code length"};
+                    }
+
+                    if (!bits.read(1)) {
+                        break;
+                    }
+
+                    length = bits.read(1) ? length - 1 : length + 1;
+                }
+
+                lengths[i] = static_cast<std::uint8_t>(length);
+            }
+
+            tables[t].build(lengths.data(), alpha_size, end_of_block);
+        }
+
+        std::array<std::uint8_t, 256> mtf{};
+
+        for (std::size_t i = 0; i < mtf.size(); i++) {
+            mtf[i] = static_cast<std::uint8_t>(i);
+        }
+
+        counts.fill(0);
+
+        std::size_t length{0};
+        std::size_t selector{0};
+        std::size_t group_left{0};
+        const bzip2::huffman_table *table{nullptr};
+        // pending run of the front symbol, in bijective base 2
+        std::size_t run{0};
+        unsigned run_shift{0};
+
+        const auto flush_run = [&] {
+            if (run == 0) {
+                return;
+            }
+
+            if (length + run > bzip2::max_block_size) {
+                throw std::runtime_error{
+                    "corrupt bzip2 stream: block too large"};
+            }
+
+            const auto byte = seq_to_unseq[mtf[0]];
+
+            counts[byte] += run;
+            std::fill_n(tt.data() + length, run, byte);
+            length += run;
+            run = 0;
+            run_shift = 0;
+        };
+
+        // returns true once the end of the block is reached
+        const auto apply = [&](const std::uint16_t symbol) {
+            if (symbol <= 1) {
+                if (run_shift > 20) {
+                    throw std::runtime_error{
+                        "corrupt bzip2 stream: run too long"};
+                }
+
+                // RUNA adds 1 << n, RUNB adds 2 << n
+                run += static_cast<std::size_t>(symbol + 1) << run_shift++;
+                return false;
+            }
+
+            flush_run();
+
+            if (symbol == end_of_block) {
+                return true;
+            }
+
+            if (length >= bzip2::max_block_size) {
+                throw std::runtime_error{
+                    "corrupt bzip2 stream: block too large"};
+            }
+
+            const auto index = symbol - 1;
+            const auto value = mtf[index];
+
+            std::memmove(mtf.data() + 1, mtf.data(), index);
+            mtf[0] = value;
+
+            const auto byte = seq_to_unseq[value];
+
+            counts[byte]++;
+            tt[length++] = byte;
+            return false;
+        };
+
+        while (true) {
+            if (group_left == 0) {
+                if (selector >= usable_selectors) {
+                    throw std::runtime_error{
+                        "corrupt bzip2 stream: out of selectors"};
+                }
+
+                table = &tables[selectors[selector++]];
+                group_left = bzip2::group_size;
+            }
+
+            bits.refill();
+
+            const auto slot = table->lookup[bits.peek(bzip2::lookup_bits)];
+            using huffman = bzip2::huffman_table;
+
+            if (huffman::count(slot) == 2 && group_left >= 2) {
+                bits.consume(huffman::total_length(slot));
+                group_left -= 2;
+
+                if (apply(huffman::symbol(slot)) ||
+                    apply(huffman::second_symbol(slot))) {
+                    break;
+                }
+            } else {
+                std::uint16_t symbol{};
+
+                if (huffman::count(slot) > 0) {
+                    bits.consume(huffman::length(slot));
+                    symbol = huffman::symbol(slot);
+                } else {
+                    symbol = table->decode_slow(bits);
+                }
+
+                group_left--;
+
+                if (apply(symbol)) {
+                    break;
+                }
+            }
+
+            if (bits.overrun()) {
+                throw std::runtime_error{"truncated bzip2 stream"};
+            }
+        }
+
+        return length;
+    }
+
+    // Undoes the block's burrows-wheeler transform and its initial run
+    // length coding, in which 4 equal bytes are followed by a count of
+    // further repeats.
+    void inverse_bwt(std::uint32_t orig_ptr, std::size_t length,
+                     std::vector<char> &out) {
+        std::array<std::uint32_t, 256> next{};
+
+        for (std::size_t i = 0, sum = 0; i < next.size(); i++) {
+            next[i] = static_cast<std::uint32_t>(sum);
+            sum += counts[i];
+        }
+
+        for (std::uint32_t i = 0; i < length; i++) {
+            tt[next[tt[i] & 0xff]++] |= i << 8;
+        }
+
+        const auto start = out.size();
+        // runs rarely expand a block by much, so start with a little room
+        // to spare and grow as needed
+        out.resize(start + length + length / 4 + 1);
+
+        auto *dest = out.data() + start;
+        auto *dest_end = out.data() + out.size();
+
+        const auto grow = [&](std::size_t needed) {
+            const auto used = dest - out.data();
+
+            out.resize(std::max(out.size() * 2, used + needed));
+            dest = out.data() + used;
+            dest_end = out.data() + out.size();
+        };
+
+        auto pos = tt[orig_ptr] >> 8;
+        int last{-1};
+        unsigned run{0};
+
+        for (std::size_t i = 0; i < length; i++) {
+            const auto entry = tt[pos];
+            const auto byte = static_cast<int>(entry & 0xff);
+
+            pos = entry >> 8;
+
+            if (run == 4) {
+                if (dest_end - dest < byte) {
+                    grow(byte);
+                }
+
+                dest = std::fill_n(dest, byte, static_cast<char>(last));
+                run = 0;
+                continue;
+            }
+
+            if (byte == last) {
+                run++;
+            } else {
+                run = 1;
+                last = byte;
+            }
+
+            if (dest == dest_end) {
+                grow(1);
+            }
+
+            *dest++ = static_cast<char>(byte);
+        }
+
+        out.resize(dest - out.data());
+    }
+};
+namespace bzip2 {
+// like libbz2, a block is deemed full a little short of its size, leaving
+// room for the run being added when it fills up
+constexpr std::size_t block_fill = max_block_size - 19;
+constexpr unsigned max_encode_length = 17;
+
+// Writes bits most significant first.
+struct bit_writer {
+    explicit bit_writer(std::vector<char> &out) : out{out} {}
+
+    // n must be between 1 and 32
+    void write(unsigned n, std::uint32_t value) {
+        bits = (bits << n) | value;
+        count += n;
+
+        while (count >= 8) {
+            count -= 8;
+            out.push_back(static_cast<char>(bits >> count));
+        }
+    }
+
+    // pads the last byte with zeros
+    void flush() {
+        if (count > 0) {
+            out.push_back(static_cast<char>(bits << (8 - count)));
+            count = 0;
+        }
+    }
+
+  private:
+    std::vector<char> &out;
+    std::uint64_t bits{0};
+    unsigned count{0};
+};
+
+// Computes huffman code lengths for the given symbol frequencies, no longer
+// than max_len. Too long codes are dealt with as libbz2 does, by flattening
+// the frequencies and trying again.
+void make_code_lengths(std::uint8_t *lengths, const std::uint32_t *freqs,
+                       std::size_t alpha_size, unsigned max_len) {
+    std::array<std::uint64_t, max_alpha_size> weights{};
+
+    for (std::size_t i = 0; i < alpha_size; i++) {
+        weights[i] = std::max<std::uint64_t>(freqs[i], 1);
+    }
+
+    using node = std::pair<std::uint64_t, std::int32_t>;
+
+    while (true) {
+        std::array<std::int32_t, max_alpha_size * 2> parents{};
+        std::priority_queue<node, std::vector<node>, std::greater<node>>
+            heap{};
+
+        for (std::size_t i = 0; i < alpha_size; i++) {
+            heap.push({weights[i], static_cast<std::int32_t>(i)});
+        }
+
+        auto next = static_cast<std::int32_t>(alpha_size);
+
+        while (heap.size() > 1) {
+            const auto a = heap.top();
+            heap.pop();
+            const auto b = heap.top();
+            heap.pop();
+
+            parents[a.second] = parents[b.second] = next;
+            heap.push({a.first + b.first, next++});
+        }
+
+        parents[next - 1] = -1;
+
+        auto too_long = false;
+
+        for (std::size_t i = 0; i < alpha_size; i++) {
+            unsigned depth{0};
+
+            for (auto j = static_cast<std::int32_t>(i); parents[j] >= 0;
+                 j = parents[j]) {
+                depth++;
+            }
+
+            lengths[i] = static_cast<std::uint8_t>(depth);
+            too_long |= depth > max_len;
+        }
+
+        if (!too_long) {
+            return;
+        }
+
+        for (std::size_t i = 0; i < alpha_size; i++) {
+            weights[i] = 1 + weights[i] / 2;
+        }
+    }
+}
+
+// Computes the huffman code lengths minimising the coded size of the given
+// symbol frequencies, none longer than max_len, by package merge. Slower
+// than make_code_lengths, which is only optimal until a code gets too long.
+void make_optimal_code_lengths(std::uint8_t *lengths,
+                               const std::uint32_t *freqs,
+                               std::size_t alpha_size, unsigned max_len) {
+    // an item is a symbol, or a package of two items from the level below
+    struct item {
+        std::uint64_t weight;
+        std::int32_t symbol;
+        std::int32_t first;
+    };
+
+    std::vector<item> leaves{};
+    leaves.reserve(alpha_size);
+
+    for (std::size_t i = 0; i < alpha_size; i++) {
+        leaves.push_back({std::max<std::uint64_t>(freqs[i], 1),
+                          static_cast<std::int32_t>(i), -1});
+        lengths[i] = 0;
+    }
+
+    std::stable_sort(
+        std::begin(leaves), std::end(leaves),
+        [](const auto &a, const auto &b) { return a.weight < b.weight; });
+
+    std::vector<std::vector<item>> levels{leaves};
+    levels.reserve(max_len);
+
+    for (unsigned level = 1; level < max_len; level++) {
+        const auto &below = levels.back();
+        std::vector<item> merged{};
+        merged.reserve(alpha_size * 2);
+
+        std::size_t leaf{0};
+
+        for (std::size_t i = 0; i + 1 < below.size() || leaf < alpha_size;) {
+            const auto packable = i + 1 < below.size();
+            const auto package =
+                packable ? below[i].weight + below[i + 1].weight : 0;
+
+            if (leaf < alpha_size &&
+                (!packable || leaves[leaf].weight <= package)) {
+                merged.push_back(leaves[leaf++]);
+            } else {
+                merged.push_back({package, -1, static_cast<std::int32_t>(i)});
+                i += 2;
+            }
+        }
+
+        levels.push_back(std::move(merged));
+    }
+
+    // the cheapest 2n - 2 items of the top level make up the code, every
+    // time a symbol appears among them, expanding packages, lengthens its
+    // code by one
+    auto selected = alpha_size * 2 - 2;
+
+    for (auto level = levels.size(); level-- > 0;) {
+        std::size_t packages{0};
+
+        for (std::size_t i = 0; i < selected; i++) {
+            const auto &chosen = levels[level][i];
+
+            if (chosen.symbol >= 0) {
+                lengths[chosen.symbol]++;
+            } else {
+                packages = chosen.first + 2;
+            }
+        }
+
+        selected = packages;
+    }
+}
+
+// How hard the encoder works at choosing its coding tables.
+struct effort {
+    // the most rounds of refining the tables against the groups using them
+    unsigned table_iterations;
+    // whether every number of tables is tried, rather than one picked from
+    // the block's length as libbz2 does
+    bool search_table_counts;
+    bool optimal_lengths;
+};
+
+constexpr effort normal_effort{4, false, false};
+constexpr effort max_effort{16, true, true};
+
+// the tables a block is coded with, and which group uses each
+struct block_coding {
+    std::size_t group_count{0};
+    std::array<std::array<std::uint8_t, max_alpha_size>, max_groups>
+        lengths{};
+    std::vector<std::uint8_t> selectors{};
+    // in bits, of the tables, selectors and symbols together
+    std::size_t cost{0};
+};
+
+// the number of bits coding the symbols with the given tables takes
+std::size_t coding_cost(
+    const block_coding &coding,
+    const std::array<std::array<std::uint32_t, max_alpha_size>, max_groups>
+        &table_freqs,
+    std::size_t alpha_size) {
+    std::size_t cost{0};
+
+    for (std::size_t t = 0; t < coding.group_count; t++) {
+        int length = coding.lengths[t][0];
+        cost += 5;
+
+        for (std::size_t i = 0; i < alpha_size; i++) {
+            const int next = coding.lengths[t][i];
+
+            cost += 1 + 2 * static_cast<std::size_t>(std::abs(next - length));
+            cost += static_cast<std::size_t>(next) * table_freqs[t][i];
+            length = next;
+        }
+    }
+
+    std::array<std::uint8_t, max_groups> order{0, 1, 2, 3, 4, 5};
+
+    for (const auto selector : coding.selectors) {
+        const auto index = static_cast<std::size_t>(
+            std::find(std::begin(order), std::end(order), selector) -
+            std::begin(order));
+
+        cost += index + 1;
+        std::memmove(order.data() + 1, order.data(), index);
+        order[0] = selector;
+    }
+
+    return cost;
+}
+
+// Chooses group_count tables to code the symbols with, keeping the cheapest
+// tables found.
+block_coding choose_coding(const std::vector<std::uint16_t> &symbols,
+                           const std::uint32_t *freqs, std::size_t alpha_size,
+                           std::size_t group_count, const effort &settings) {
+    block_coding coding{};
+    coding.group_count = group_count;
+
+    // start each table off favouring its own slice of the alphabet, slices
+    // holding roughly equal shares of the symbols
+    auto &lengths = coding.lengths;
+    auto remaining = static_cast<std::int64_t>(symbols.size());
+    const auto alpha = static_cast<std::int64_t>(alpha_size);
+    std::int64_t first{0};
+
+    for (auto parts = group_count; parts > 0; parts--) {
+        const auto target = remaining / static_cast<std::int64_t>(parts);
+        auto last = first - 1;
+        std::int64_t share{0};
+
+        while (share < target && last < alpha - 1) {
+            share += freqs[++last];
+        }
+
+        if (last > first && parts != group_count && parts != 1 &&
+            (group_count - parts) % 2 == 1) {
+            share -= freqs[last--];
+        }
+
+        for (std::int64_t i = 0; i < alpha; i++) {
+            lengths[parts - 1][i] = (i >= first && i <= last) ? 0 : 15;
+        }
+
+        first = last + 1;
+        remaining -= share;
+    }
+
+    // then repeatedly pick the cheapest table for every group of symbols,
+    // and rebuild each table from the symbols it was picked for, until the
+    // picks stop changing
+    block_coding best{};
+    std::vector<std::uint8_t> previous{};
+
+    for (unsigned iteration = 0; iteration < settings.table_iterations;
+         iteration++) {
+        std::array<std::array<std::uint32_t, max_alpha_size>, max_groups>
+            table_freqs{};
+
+        previous.swap(coding.selectors);
+        coding.selectors.clear();
+
+        // every table's code length for a symbol packed 10 bits apiece, so
+        // a group's cost under each table is summed at once, as a group's
+        // cost can't exceed 50 * 17
+        std::array<std::uint64_t, max_alpha_size> packed{};
+
+        for (std::size_t i = 0; i < alpha_size; i++) {
+            for (std::size_t t = 0; t < group_count; t++) {
+                packed[i] |= static_cast<std::uint64_t>(lengths[t][i])
+                             << (t * 10);
+            }
+        }
+
+        for (std::size_t start = 0; start < symbols.size();
+             start += group_size) {
+            const auto end = std::min(start + group_size, symbols.size());
+            std::uint64_t costs{0};
+
+            for (auto i = start; i < end; i++) {
+                costs += packed[symbols[i]];
+            }
+
+            std::size_t choice{0};
+            std::uint32_t choice_cost{~0u};
+
+            for (std::size_t t = 0; t < group_count; t++) {
+                const auto cost =
+                    static_cast<std::uint32_t>(costs >> (t * 10)) & 0x3ff;
+
+                if (cost < choice_cost) {
+                    choice = t;
+                    choice_cost = cost;
+                }
+            }
+
+            coding.selectors.push_back(static_cast<std::uint8_t>(choice));
+
+            for (auto i = start; i < end; i++) {
+                table_freqs[choice][symbols[i]]++;
+            }
+        }
+
+        if (coding.selectors == previous) {
+            break;
+        }
+
+        for (std::size_t t = 0; t < group_count; t++) {
+            if (settings.optimal_lengths) {
+                make_optimal_code_lengths(lengths[t].data(),
+                                          table_freqs[t].data(), alpha_size,
+                                          max_encode_length);
+            } else {
+                make_code_lengths(lengths[t].data(), table_freqs[t].data(),
+                                  alpha_size, max_encode_length);
+            }
+        }
+
+        coding.cost = coding_cost(coding, table_freqs, alpha_size);
+
+        if (best.group_count == 0 || coding.cost < best.cost) {
+            best = coding;
+        }
+    }
+
+    return best;
+}
+
+// Encodes one block, the input's crc having been taken before its runs
+// were coded.
+void write_block(bit_writer &bits, const std::vector<std::uint8_t> &block,
+                 std::uint32_t crc, const effort &settings) {
+    const auto n = block.size();
+    const auto rotations = sort_rotations(block.data(), n);
+
+    std::array<bool, 256> used{};
+
+    for (const auto byte : block) {
+        used[byte] = true;
+    }
+
+    std::array<std::uint8_t, 256> unseq_to_seq{};
+    std::size_t in_use{0};
+
+    for (std::size_t i = 0; i < used.size(); i++) {
+        if (used[i]) {
+            unseq_to_seq[i] = static_cast<std::uint8_t>(in_use++);
+        }
+    }
+
+    const auto alpha_size = in_use + 2;
+    const auto end_of_block = static_cast<std::uint16_t>(in_use + 1);
+
+    // move to front code the transformed block, with runs of the front
+    // symbol written in bijective base 2 as RUNA and RUNB
+    std::vector<std::uint16_t> symbols{};
+    symbols.reserve(n + 1);
+
+    std::array<std::uint8_t, 256> mtf{};
+
+    for (std::size_t i = 0; i < mtf.size(); i++) {
+        mtf[i] = static_cast<std::uint8_t>(i);
+    }
+
+    std::uint32_t orig_ptr{0};
+    std::size_t run{0};
+
+    const auto flush_run = [&] {
+        if (run == 0) {
+            return;
+        }
+
+        for (auto left = run - 1;; left = (left - 2) / 2) {
+            symbols.push_back(left & 1);
+
+            if (left < 2) {
+                break;
+            }
+        }
+
+        run = 0;
+    };
+
+    for (std::size_t i = 0; i < n; i++) {
+        const auto rotation = static_cast<std::size_t>(rotations[i]);
+
+        if (rotation == 0) {
+            orig_ptr = static_cast<std::uint32_t>(i);
+        }
+
+        const auto value = unseq_to_seq[block[(rotation + n - 1) % n]];
+
+        if (mtf[0] == value) {
+            run++;
+            continue;
+        }
+
+        flush_run();
+
+        const auto index = static_cast<std::size_t>(
+            static_cast<const std::uint8_t *>(
+                std::memchr(mtf.data(), value, mtf.size())) -
+            mtf.data());
+
+        std::memmove(mtf.data() + 1, mtf.data(), index);
+        mtf[0] = value;
+        symbols.push_back(static_cast<std::uint16_t>(index + 1));
+    }
+
+    flush_run();
+    symbols.push_back(end_of_block);
+
+    std::array<std::uint32_t, max_alpha_size> freqs{};
+
+    for (const auto symbol : symbols) {
+        freqs[symbol]++;
+    }
+
+    const std::size_t default_count = symbols.size() < 200    ? 2
+                                      : symbols.size() < 600  ? 3
+                                      : symbols.size() < 1200 ? 4
+                                      : symbols.size() < 2400 ? 5
+                                                              : 6;
+
+    auto coding = choose_coding(symbols, freqs.data(), alpha_size,
+                                default_count, settings);
+
+    for (std::size_t count = 2;
+         settings.search_table_counts && count <= max_groups; count++) {
+        if (count == default_count) {
+            continue;
+        }
+
+        auto candidate = choose_coding(symbols, freqs.data(), alpha_size,
+                                       count, settings);
+
+        if (candidate.cost < coding.cost) {
+            coding = std::move(candidate);
+        }
+    }
+
+    const auto group_count = coding.group_count;
+    const auto &lengths = coding.lengths;
+    const auto &selectors = coding.selectors;
+
+    std::array<std::array<std::uint32_t, max_alpha_size>, max_groups>
+        codes{};
+
+    for (std::size_t t = 0; t < group_count; t++) {
+        std::uint32_t code{0};
+
+        for (unsigned len = 1; len <= max_encode_length; len++) {
+            for (std::size_t i = 0; i < alpha_size; i++) {
+                if (lengths[t][i] == len) {
+                    codes[t][i] = code++;
+                }
+            }
+
+            code <<= 1;
+        }
+    }
+
+    bits.write(24, block_magic >> 24);
+    bits.write(24, block_magic & 0xffffff);
+    bits.write(32, crc);
+    // never randomised
+    bits.write(1, 0);
+    bits.write(24, orig_ptr);
+
+    std::uint32_t used_groups{0};
+
+    for (unsigned i = 0; i < 16; i++) {
+        if (std::any_of(std::begin(used) + i * 16,
+                        std::begin(used) + i * 16 + 16,
+                        [](const auto u) { return u; })) {
+            used_groups |= 0x8000 >> i;
+        }
+    }
+
+    bits.write(16, used_groups);
+
+    for (unsigned i = 0; i < 16; i++) {
+        if ((used_groups & (0x8000 >> i)) == 0) {
+            continue;
+        }
+
+        std::uint32_t group{0};
+
+        for (unsigned j = 0; j < 16; j++) {
+            if (used[i * 16 + j]) {
+                group |= 0x8000 >> j;
+            }
+        }
+
+        bits.write(16, group);
+    }
+
+    bits.write(3, static_cast<std::uint32_t>(group_count));
+    bits.write(15, static_cast<std::uint32_t>(selectors.size()));
+
+    std::array<std::uint8_t, max_groups> order{0, 1, 2, 3, 4, 5};
+
+    for (const auto selector : selectors) {
+        const auto index = static_cast<unsigned>(
+            std::find(std::begin(order), std::end(order), selector) -
+            std::begin(order));
+
+        // index ones then a zero
+        bits.write(index + 1, ((1u << index) - 1) << 1);
+        std::memmove(order.data() + 1, order.data(), index);
+        order[0] = selector;
+    }
+
+    for (std::size_t t = 0; t < group_count; t++) {
+        unsigned length = lengths[t][0];
+        bits.write(5, length);
+
+        for (std::size_t i = 0; i < alpha_size; i++) {
+            for (; length < lengths[t][i]; length++) {
+                bits.write(2, 2);
+            }
+
+            for (; length > lengths[t][i]; length--) {
+                bits.write(2, 3);
+            }
+
+            bits.write(1, 0);
+        }
+    }
+
+    for (std::size_t group = 0; group < selectors.size(); group++) {
+        const auto t = selectors[group];
+        const auto start = group * group_size;
+        const auto end = std::min(start + group_size, symbols.size());
+
+        for (auto i = start; i < end; i++) {
+            bits.write(lengths[t][symbols[i]], codes[t][symbols[i]]);
+        }
+    }
+}
+} // namespace bzip2
+
+// Compresses data into a jag bzip2 stream, which is a standard bzip2 stream
+// with 100k blocks minus its "BZh1" header. Blocks are sorted by suffix array
+// construction rather than libbz2's comparison sorts, so highly repetitive
+// data compresses as quickly as anything else. At the max level the coding
+// tables are searched for more thoroughly, for a few percent less output.
+std::vector<char>
+bzip2_compress(const std::vector<char> &data,
+               compression_level level = compression_level::normal) {
+    const auto &settings = level == compression_level::max
+                               ? bzip2::max_effort
+                               : bzip2::normal_effort;
+
+    std::vector<char> out{};
+    out.reserve(data.size() / 4 + 64);
+
+    bzip2::bit_writer bits{out};
+    std::vector<std::uint8_t> block{};
+    std::uint32_t combined_crc{0};
+    std::size_t pos{0};
+
+    block.reserve(bzip2::max_block_size);
+
+    while (pos < data.size()) {
+        const auto start = pos;
+
+        block.clear();
+
+        // runs of 4 to 255 equal bytes become 4 bytes and a count of the
+        // rest
+        while (pos < data.size() && block.size() < bzip2::block_fill) {
+            const auto byte = static_cast<std::uint8_t>(data[pos]);
+            std::size_t run{1};
+
+            while (run < 255 && pos + run < data.size() &&
+                   data[pos + run] == data[pos]) {
+                run++;
+            }
+
+            block.insert(std::end(block), std::min<std::size_t>(run, 4),
+                         byte);
+
+            if (run >= 4) {
+                block.push_back(static_cast<std::uint8_t>(run - 4));
+            }
+
+            pos += run;
+        }
+
+        const auto crc = bzip2::block_crc(data.data() + start, pos - start);
+
+        combined_crc = ((combined_crc << 1) | (combined_crc >> 31)) ^ crc;
+        bzip2::write_block(bits, block, crc, settings);
+    }
+
+    bits.write(24, bzip2::end_magic >> 24);
+    bits.write(24, bzip2::end_magic & 0xffffff);
+    bits.write(32, combined_crc);
+    bits.flush();
+
+    return out;
+}
+} // namespace sysd::jag::detail
+
+#endif // SYSD_JAG_BZIP2_HPP
@@ -10,10 +10,33 @@
 #include <boost/iostreams/filter/bzip2.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 
+#include <sysd/jag/detail/bzip2.hpp>
+#include <sysd/jag/stats.hpp>
+
 namespace sysd::jag::detail {
 using container_type = std::vector<char>;
 
-auto compress(const container_type &buffer) {
+// describes the codec and the parameters compress() runs it with, anything
+// persisting compressed output keyed on its input must take this into account
+constexpr const char *codec_params(compression_level level) {
+    return level == compression_level::max
+               ? "bzip2;block=1;encoder=native;level=max"
+               : "bzip2;block=1;encoder=native";
+}
+
+auto compress(const container_type &buffer,
+              compression_level level = compression_level::normal) {
+    phase_scope scope{phase::compress, buffer.size()};
+    auto compressed = bzip2_compress(buffer, level);
+
+    scope.bytes_out(compressed.size());
+    return compressed;
+}
+
+// Compresses through libbz2 rather than the native encoder. The output
+// differs, but decodes to the same data.
+auto compress_libbz2(const container_type &buffer) {
+    phase_scope scope{phase::compress, buffer.size()};
     container_type compressed{};
 
     boost::iostreams::filtering_ostream out{};
@@ -31,6 +54,7 @@ auto compress(const container_type &buffer) {
     std::advance(end, 4);
     compressed.erase(begin, end);
 
+    scope.bytes_out(compressed.size());
     return compressed;
 }
 } // namespace sysd::jag::detail
@@ -0,0 +1,169 @@
+#ifndef SYSD_JAG_CRC32_HPP
+#define SYSD_JAG_CRC32_HPP
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SYSD_JAG_CRC32_CLMUL 1
+#endif
+
+namespace sysd::jag::detail {
+namespace {
+// the reflected CRC-32 (zlib, java.util.zip.CRC32) tables for slicing by 8,
+// table n advancing a byte through n more zero bytes
+constexpr auto crc32_tables = [] {
+    std::array<std::array<std::uint32_t, 256>, 8> tables{};
+
+    for (std::uint32_t i = 0; i < 256; i++) {
+        auto crc = i;
+
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1)));
+        }
+
+        tables[0][i] = crc;
+    }
+
+    for (std::size_t t = 1; t < tables.size(); t++) {
+        for (std::uint32_t i = 0; i < 256; i++) {
+            const auto previous = tables[t - 1][i];
+            tables[t][i] = (previous >> 8) ^ tables[0][previous & 0xff];
+        }
+    }
+
+    return tables;
+}();
+
+// crc is the register, without crc32()'s inversions
+std::uint32_t crc32_slice8(const unsigned char *p, std::size_t len,
+                           std::uint32_t crc) {
+    const auto &t = crc32_tables;
+
+    for (; len >= 8; p += 8, len -= 8) {
+        std::uint32_t low;
+        std::uint32_t high;
+        std::memcpy(&low, p, sizeof(low));
+        std::memcpy(&high, p + 4, sizeof(high));
+
+        low ^= crc;
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^
+              t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+              t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^
+              t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+    }
+
+    for (; len > 0; p++, len--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+    }
+
+    return crc;
+}
+
+#ifdef SYSD_JAG_CRC32_CLMUL
+// folds x forward by the distance k was computed for, onto next
+__attribute__((target("pclmul"))) __m128i crc32_fold(__m128i x, __m128i k,
+                                                      __m128i next) {
+    const auto low = _mm_clmulepi64_si128(x, k, 0x00);
+    const auto high = _mm_clmulepi64_si128(x, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(high, low), next);
+}
+
+// Folds 64 bytes at a time with carry-less multiplication, then reduces the
+// remainder with Barrett reduction, per Intel's "Fast CRC Computation for
+// Generic Polynomials Using PCLMULQDQ Instruction". len must be a multiple of
+// 16, and at least 64.
+__attribute__((target("pclmul,sse4.1"))) std::uint32_t
+crc32_clmul(const unsigned char *p, std::size_t len, std::uint32_t crc) {
+    // x^n mod P for the distances folded over, in the reflected domain
+    alignas(16) static constexpr std::uint64_t k1k2[] = {0x0154442bd4,
+                                                         0x01c6e41596};
+    alignas(16) static constexpr std::uint64_t k3k4[] = {0x01751997d0,
+                                                         0x00ccaa009e};
+    alignas(16) static constexpr std::uint64_t k5k0[] = {0x0163cd6124, 0};
+    // P and Barrett's constant floor(x^64 / P)
+    alignas(16) static constexpr std::uint64_t poly[] = {0x01db710641,
+                                                         0x01f7011641};
+
+    const auto load = [](const unsigned char *at) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(at));
+    };
+
+    auto x1 = _mm_xor_si128(load(p), _mm_cvtsi32_si128(crc));
+    auto x2 = load(p + 16);
+    auto x3 = load(p + 32);
+    auto x4 = load(p + 48);
+    auto k = _mm_load_si128(reinterpret_cast<const __m128i *>(k1k2));
+
+    for (p += 64, len -= 64; len >= 64; p += 64, len -= 64) {
+        x1 = crc32_fold(x1, k, load(p));
+        x2 = crc32_fold(x2, k, load(p + 16));
+        x3 = crc32_fold(x3, k, load(p + 32));
+        x4 = crc32_fold(x4, k, load(p + 48));
+    }
+
+    k = _mm_load_si128(reinterpret_cast<const __m128i *>(k3k4));
+    x1 = crc32_fold(x1, k, x2);
+    x1 = crc32_fold(x1, k, x3);
+    x1 = crc32_fold(x1, k, x4);
+
+    for (; len >= 16; p += 16, len -= 16) {
+        x1 = crc32_fold(x1, k, load(p));
+    }
+
+    // 128 bits down to 64
+    const auto mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+    k = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(k5k0));
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // and Barrett reduced to 32
+    k = _mm_load_si128(reinterpret_cast<const __m128i *>(poly));
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x10);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask), k, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return static_cast<std::uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+bool has_clmul() {
+    static const bool supported =
+        __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    return supported;
+}
+#endif
+} // namespace
+
+// The CRC-32 used by zip, zlib and java.util.zip.CRC32, continued from crc so
+// data can be checksummed in pieces. Uses carry-less multiplication when the
+// cpu has it, and slicing by 8 otherwise. (SSE4.2's crc32 instruction is no
+// help, it computes the Castagnoli CRC-32C.)
+std::uint32_t crc32(const char *data, std::size_t len,
+                    std::uint32_t crc = 0) {
+    const auto *p = reinterpret_cast<const unsigned char *>(data);
+    crc = ~crc;
+
+#ifdef SYSD_JAG_CRC32_CLMUL
+    if (len >= 64 && has_clmul()) {
+        const auto bulk = len & ~std::size_t{15};
+
+        crc = crc32_clmul(p, bulk, crc);
+        p += bulk;
+        len -= bulk;
+    }
+#endif
+
+    return ~crc32_slice8(p, len, crc);
+}
+} // namespace sysd::jag::detail
+
+#endif // SYSD_JAG_CRC32_HPP
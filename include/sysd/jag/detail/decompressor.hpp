@@ -3,17 +3,44 @@
 
 #pragma once
 
+#include <algorithm>
+#include <stdexcept>
 #include <vector>
 
 #include <boost/iostreams/copy.hpp>
 #include <boost/iostreams/filter/bzip2.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 
+#include <sysd/jag/detail/bzip2.hpp>
+#include <sysd/jag/stats.hpp>
+
 namespace sysd::jag::detail {
 using container_type = std::vector<char>;
 
 auto decompress(const container_type &buffer, const std::size_t &offset,
                 const std::size_t &decomp_len) {
+    phase_scope scope{phase::decompress, buffer.size() - offset};
+    bzip2_decoder decoder{buffer.data() + offset, buffer.size() - offset};
+
+    container_type decompressed{};
+    decompressed.reserve(decomp_len);
+
+    while (decoder.decode_block(decompressed)) {
+    }
+
+    if (decompressed.size() != decomp_len) {
+        throw std::runtime_error{"unexpected decompressed length"};
+    }
+
+    scope.bytes_out(decomp_len);
+    return decompressed;
+}
+
+// Decompresses through libbz2 rather than the native decoder, which it's
+// validated against.
+auto decompress_libbz2(const container_type &buffer, const std::size_t &offset,
+                       const std::size_t &decomp_len) {
+    phase_scope scope{phase::decompress, buffer.size() - offset};
     container_type compressed = {'B', 'Z', 'h', '1'};
 
     auto in_begin = std::cbegin(buffer);
@@ -48,8 +75,67 @@ auto decompress(const container_type &buffer, const std::size_t &offset,
 
     boost::iostreams::copy(in, out);
 
+    scope.bytes_out(decomp_len);
     return decompressed;
 }
+
+// Decodes a headerless jag bzip2 stream incrementally, a block at a time,
+// producing only as much output as has been asked for. Useful when just the
+// start of a compressed body is needed, such as an archive's entry table.
+struct partial_decompressor {
+    partial_decompressor(const container_type &buffer,
+                         const std::size_t &offset,
+                         const std::size_t &decomp_len)
+        : decoder{buffer.data() + offset, buffer.size() - offset},
+          consumed{buffer.size() - offset}, expected{decomp_len} {
+        output.reserve(decomp_len);
+    }
+
+    partial_decompressor(const partial_decompressor &) = delete;
+    partial_decompressor &operator=(const partial_decompressor &) = delete;
+
+    // decodes until at least len bytes of output exist, or the stream ends
+    const container_type &decode_until(const std::size_t &len) {
+        const auto target = std::min(len, expected);
+
+        if (decoder.finished() || output.size() >= target) {
+            return output;
+        }
+
+        phase_scope scope{phase::decompress};
+        const auto initial = output.size();
+
+        // once everything is asked for, the stream's end is read too so its
+        // combined crc gets checked
+        while ((output.size() < target || target == expected) &&
+               decoder.decode_block(output)) {
+        }
+
+        if (output.size() > expected ||
+            (output.size() < target && decoder.finished())) {
+            throw std::runtime_error{"unexpected decompressed length"};
+        }
+
+        // blocks aren't byte aligned, so the input used is only known once
+        // the whole stream has been
+        if (decoder.finished()) {
+            scope.bytes_in(consumed);
+        }
+
+        scope.bytes_out(output.size() - initial);
+        return output;
+    }
+
+    const container_type &decode_all() { return decode_until(expected); }
+
+    const container_type &data() const { return output; }
+
+  private:
+    bzip2_decoder decoder;
+    container_type output{};
+    std::size_t consumed;
+    std::size_t expected;
+};
 } // namespace sysd::jag::detail
 
 #endif // SYSD_JAG_DECOMPRESSOR_HPP
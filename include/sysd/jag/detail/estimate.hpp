@@ -0,0 +1,89 @@
+#ifndef SYSD_JAG_ESTIMATE_HPP
+#define SYSD_JAG_ESTIMATE_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace sysd::jag::detail {
+// Guesses whether bzip2 would make data any smaller, without compressing it.
+// A handful of windows spread over the data are sampled. Data whose bytes
+// are close to uniformly distributed, and which barely repeats itself, is
+// most likely compressed already (PNG, OGG, JPEG, nested archives), and
+// bzip2 only makes those bigger.
+bool likely_compressible(const std::vector<char> &data) {
+    constexpr std::size_t window_count = 8;
+    constexpr std::size_t window_size = 1024;
+    // bits per byte, 8 is indistinguishable from random
+    constexpr double entropy_limit = 7.9;
+
+    std::vector<std::size_t> windows{};
+
+    if (data.size() <= window_count * window_size) {
+        windows.push_back(0);
+    } else {
+        const auto stride = (data.size() - window_size) / (window_count - 1);
+
+        for (std::size_t i = 0; i < window_count; i++) {
+            windows.push_back(i * stride);
+        }
+    }
+
+    const auto length = std::min(data.size(), window_count * window_size) /
+                        windows.size();
+
+    std::array<std::size_t, 256> counts{};
+    // the last position each (hashed) 4 byte sequence was seen at, as in an
+    // lz match finder
+    std::array<std::uint32_t, 4096> last_seen{};
+    std::size_t repeats{0};
+    std::size_t sampled{0};
+
+    for (const auto start : windows) {
+        const auto *window = data.data() + start;
+
+        for (std::size_t i = 0; i < length; i++) {
+            counts[static_cast<unsigned char>(window[i])]++;
+        }
+
+        for (std::size_t i = 0; i + 4 <= length; i++) {
+            std::uint32_t sequence{};
+            std::memcpy(&sequence, window + i, sizeof(sequence));
+
+            auto &seen = last_seen[(sequence * 2654435761u) >> 20];
+            const auto position = static_cast<std::uint32_t>(start + i);
+
+            if (seen != 0 &&
+                std::memcmp(data.data() + seen - 1, window + i, 4) == 0) {
+                repeats++;
+            }
+
+            seen = position + 1;
+        }
+
+        sampled += length;
+    }
+
+    if (sampled == 0) {
+        return false;
+    }
+
+    double entropy{0};
+
+    for (const auto count : counts) {
+        if (count > 0) {
+            const auto p = static_cast<double>(count) / sampled;
+            entropy -= p * std::log2(p);
+        }
+    }
+
+    return entropy < entropy_limit || repeats * 64 > sampled;
+}
+} // namespace sysd::jag::detail
+
+#endif // SYSD_JAG_ESTIMATE_HPP
@@ -0,0 +1,111 @@
+#ifndef SYSD_JAG_HASH_HPP
+#define SYSD_JAG_HASH_HPP
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace sysd::jag::detail {
+namespace {
+constexpr std::uint64_t hash_prime1 = 11400714785074694791ULL;
+constexpr std::uint64_t hash_prime2 = 14029467366897019727ULL;
+constexpr std::uint64_t hash_prime3 = 1609587929392839161ULL;
+constexpr std::uint64_t hash_prime4 = 9650029242287828579ULL;
+constexpr std::uint64_t hash_prime5 = 2870177450012600261ULL;
+
+constexpr std::uint64_t rotl64(std::uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+std::uint64_t load64(const char *p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+std::uint32_t load32(const char *p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+constexpr std::uint64_t hash_round(std::uint64_t acc, std::uint64_t input) {
+    acc += input * hash_prime2;
+    acc = rotl64(acc, 31);
+    return acc * hash_prime1;
+}
+
+constexpr std::uint64_t hash_merge(std::uint64_t acc, std::uint64_t val) {
+    acc ^= hash_round(0, val);
+    return acc * hash_prime1 + hash_prime4;
+}
+} // namespace
+
+// A 64 bit non-cryptographic content hash (XXH64). It is only used to detect
+// whether entry data changed between runs, so speed matters far more than
+// collision resistance against an adversary. Assumes a little endian host.
+std::uint64_t content_hash(const char *data, std::size_t len,
+                           std::uint64_t seed = 0) {
+    const char *p = data;
+    const char *const end = data + len;
+    std::uint64_t h{0};
+
+    if (len >= 32) {
+        std::uint64_t v1 = seed + hash_prime1 + hash_prime2;
+        std::uint64_t v2 = seed + hash_prime2;
+        std::uint64_t v3 = seed;
+        std::uint64_t v4 = seed - hash_prime1;
+
+        for (const char *limit = end - 32; p <= limit; p += 32) {
+            v1 = hash_round(v1, load64(p));
+            v2 = hash_round(v2, load64(p + 8));
+            v3 = hash_round(v3, load64(p + 16));
+            v4 = hash_round(v4, load64(p + 24));
+        }
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = hash_merge(h, v1);
+        h = hash_merge(h, v2);
+        h = hash_merge(h, v3);
+        h = hash_merge(h, v4);
+    } else {
+        h = seed + hash_prime5;
+    }
+
+    h += len;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= hash_round(0, load64(p));
+        h = rotl64(h, 27) * hash_prime1 + hash_prime4;
+    }
+
+    if (p + 4 <= end) {
+        h ^= static_cast<std::uint64_t>(load32(p)) * hash_prime1;
+        h = rotl64(h, 23) * hash_prime2 + hash_prime3;
+        p += 4;
+    }
+
+    for (; p < end; p++) {
+        h ^= static_cast<std::uint64_t>(static_cast<unsigned char>(*p)) *
+             hash_prime5;
+        h = rotl64(h, 11) * hash_prime1;
+    }
+
+    h ^= h >> 33;
+    h *= hash_prime2;
+    h ^= h >> 29;
+    h *= hash_prime3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+std::uint64_t content_hash(const std::vector<char> &data,
+                           std::uint64_t seed = 0) {
+    return content_hash(data.data(), data.size(), seed);
+}
+} // namespace sysd::jag::detail
+
+#endif // SYSD_JAG_HASH_HPP
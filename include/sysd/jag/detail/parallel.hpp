@@ -0,0 +1,73 @@
+#ifndef SYSD_JAG_PARALLEL_HPP
+#define SYSD_JAG_PARALLEL_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sysd::jag::detail {
+std::size_t default_jobs() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Calls fn(i) for every i in [0, count) spread over up to jobs threads. Work
+// is handed out one index at a time, since entries vary wildly in size. The
+// first exception thrown by fn is rethrown on the calling thread once every
+// worker has stopped.
+template <typename F>
+void parallel_for(std::size_t count, std::size_t jobs, F &&fn) {
+    jobs = std::min(std::max<std::size_t>(jobs, 1), count);
+
+    if (jobs <= 1) {
+        for (std::size_t i = 0; i < count; i++) {
+            fn(i);
+        }
+
+        return;
+    }
+
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error{};
+    std::mutex error_mutex{};
+
+    auto worker = [&] {
+        for (auto i = next++; i < count; i = next++) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock{error_mutex};
+
+                if (!error) {
+                    error = std::current_exception();
+                }
+
+                next = count;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers{};
+    workers.reserve(jobs - 1);
+
+    for (std::size_t i = 1; i < jobs; i++) {
+        workers.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto &thread : workers) {
+        thread.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+} // namespace sysd::jag::detail
+
+#endif // SYSD_JAG_PARALLEL_HPP
@@ -0,0 +1,154 @@
+#ifndef SYSD_JAG_SHA256_HPP
+#define SYSD_JAG_SHA256_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace sysd::jag::detail {
+// SHA-256 (FIPS 180-4), fed data in as many pieces as convenient.
+struct sha256 {
+    using digest_type = std::array<std::uint8_t, 32>;
+
+    void update(const char *data, std::size_t len) {
+        const auto *p = reinterpret_cast<const std::uint8_t *>(data);
+        total += len;
+
+        if (buffered > 0) {
+            const auto taken = std::min(len, block.size() - buffered);
+
+            std::memcpy(block.data() + buffered, p, taken);
+            buffered += taken;
+            p += taken;
+            len -= taken;
+
+            if (buffered < block.size()) {
+                return;
+            }
+
+            compress(block.data());
+            buffered = 0;
+        }
+
+        for (; len >= block.size(); p += block.size(), len -= block.size()) {
+            compress(p);
+        }
+
+        std::memcpy(block.data(), p, len);
+        buffered = len;
+    }
+
+    digest_type finish() {
+        const auto bits = total * 8;
+
+        block[buffered++] = 0x80;
+
+        if (buffered > block.size() - 8) {
+            std::memset(block.data() + buffered, 0, block.size() - buffered);
+            compress(block.data());
+            buffered = 0;
+        }
+
+        std::memset(block.data() + buffered, 0, block.size() - 8 - buffered);
+
+        for (int i = 0; i < 8; i++) {
+            block[block.size() - 1 - i] =
+                static_cast<std::uint8_t>(bits >> (i * 8));
+        }
+
+        compress(block.data());
+
+        digest_type digest{};
+
+        for (std::size_t i = 0; i < state.size(); i++) {
+            for (int b = 0; b < 4; b++) {
+                digest[i * 4 + b] =
+                    static_cast<std::uint8_t>(state[i] >> (24 - b * 8));
+            }
+        }
+
+        return digest;
+    }
+
+  private:
+    static constexpr std::array<std::uint32_t, 64> round_constants{
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b,
+        0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01,
+        0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7,
+        0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152,
+        0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+        0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+        0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819,
+        0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08,
+        0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+        0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+    std::array<std::uint32_t, 8> state{0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                       0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                       0x1f83d9ab, 0x5be0cd19};
+    std::array<std::uint8_t, 64> block{};
+    std::size_t buffered{0};
+    std::uint64_t total{0};
+
+    static constexpr std::uint32_t rotr(std::uint32_t x, int r) {
+        return (x >> r) | (x << (32 - r));
+    }
+
+    void compress(const std::uint8_t *p) {
+        std::array<std::uint32_t, 64> w{};
+
+        for (std::size_t i = 0; i < 16; i++) {
+            w[i] = static_cast<std::uint32_t>(p[i * 4]) << 24 |
+                   static_cast<std::uint32_t>(p[i * 4 + 1]) << 16 |
+                   static_cast<std::uint32_t>(p[i * 4 + 2]) << 8 |
+                   static_cast<std::uint32_t>(p[i * 4 + 3]);
+        }
+
+        for (std::size_t i = 16; i < w.size(); i++) {
+            const auto s0 =
+                rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const auto s1 =
+                rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        auto [a, b, c, d, e, f, g, h] = state;
+
+        for (std::size_t i = 0; i < w.size(); i++) {
+            const auto s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+            const auto choice = (e & f) ^ (~e & g);
+            const auto t1 = h + s1 + choice + round_constants[i] + w[i];
+            const auto s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+            const auto majority = (a & b) ^ (a & c) ^ (b & c);
+            const auto t2 = s0 + majority;
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+};
+} // namespace sysd::jag::detail
+
+#endif // SYSD_JAG_SHA256_HPP
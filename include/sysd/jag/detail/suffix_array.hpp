@@ -0,0 +1,252 @@
+#ifndef SYSD_JAG_SUFFIX_ARRAY_HPP
+#define SYSD_JAG_SUFFIX_ARRAY_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace sysd::jag::detail {
+namespace {
+void bucket_bounds(const std::vector<std::int32_t> &counts,
+                   std::vector<std::int32_t> &bounds, bool ends) {
+    std::int32_t sum{0};
+
+    for (std::size_t c = 0; c < counts.size(); c++) {
+        sum += counts[c];
+        bounds[c] = ends ? sum : sum - counts[c];
+    }
+}
+
+// Builds the suffix array of s by induced sorting (SA-IS), in linear time
+// no matter how repetitive s is. s must end with a 0 found nowhere else, and
+// hold symbols below k.
+template <typename T>
+void induced_sort(const T *s, std::int32_t *sa, std::int32_t n,
+                  std::int32_t k) {
+    // whether each suffix is smaller than the one following it (S type)
+    // rather than larger (L type)
+    std::vector<std::uint8_t> stype(n);
+    stype[n - 1] = true;
+
+    for (auto i = n - 1; i-- > 0;) {
+        stype[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && stype[i + 1]);
+    }
+
+    // the leftmost S type suffix of each run of S types
+    const auto lms = [&](std::int32_t i) {
+        return i > 0 && stype[i] && !stype[i - 1];
+    };
+
+    std::vector<std::int32_t> counts(k);
+    std::vector<std::int32_t> bounds(k);
+
+    for (std::int32_t i = 0; i < n; i++) {
+        counts[s[i]]++;
+    }
+
+    const auto induce = [&] {
+        bucket_bounds(counts, bounds, false);
+
+        for (std::int32_t i = 0; i < n; i++) {
+            if (const auto j = sa[i] - 1; sa[i] > 0 && !stype[j]) {
+                sa[bounds[s[j]]++] = j;
+            }
+        }
+
+        bucket_bounds(counts, bounds, true);
+
+        for (auto i = n; i-- > 0;) {
+            if (const auto j = sa[i] - 1; sa[i] > 0 && stype[j]) {
+                sa[--bounds[s[j]]] = j;
+            }
+        }
+    };
+
+    // sort the lms substrings, by placing them at the end of their buckets
+    // and inducing everything else from them
+    bucket_bounds(counts, bounds, true);
+    std::fill(sa, sa + n, -1);
+
+    for (std::int32_t i = 1; i < n; i++) {
+        if (lms(i)) {
+            sa[--bounds[s[i]]] = i;
+        }
+    }
+
+    induce();
+
+    // gather the sorted lms substrings at the front, then name them so equal
+    // substrings share a name
+    std::int32_t lms_count{0};
+
+    for (std::int32_t i = 0; i < n; i++) {
+        if (lms(sa[i])) {
+            sa[lms_count++] = sa[i];
+        }
+    }
+
+    std::fill(sa + lms_count, sa + n, -1);
+
+    std::int32_t names{0};
+    std::int32_t previous{-1};
+
+    for (std::int32_t i = 0; i < lms_count; i++) {
+        const auto pos = sa[i];
+        auto differs = previous < 0;
+
+        for (std::int32_t d = 0; !differs; d++) {
+            if (s[pos + d] != s[previous + d] ||
+                stype[pos + d] != stype[previous + d]) {
+                differs = true;
+            } else if (d > 0 && (lms(pos + d) || lms(previous + d))) {
+                break;
+            }
+        }
+
+        if (differs) {
+            names++;
+            previous = pos;
+        }
+
+        sa[lms_count + pos / 2] = names - 1;
+    }
+
+    for (auto i = n, j = n; i-- > lms_count;) {
+        if (sa[i] >= 0) {
+            sa[--j] = sa[i];
+        }
+    }
+
+    // sort the lms suffixes themselves, recursing when names repeat
+    auto *reduced = sa + n - lms_count;
+
+    if (names < lms_count) {
+        induced_sort(reduced, sa, lms_count, names);
+    } else {
+        for (std::int32_t i = 0; i < lms_count; i++) {
+            sa[reduced[i]] = i;
+        }
+    }
+
+    for (std::int32_t i = 1, j = 0; i < n; i++) {
+        if (lms(i)) {
+            reduced[j++] = i;
+        }
+    }
+
+    for (std::int32_t i = 0; i < lms_count; i++) {
+        sa[i] = reduced[sa[i]];
+    }
+
+    // and induce the order of every suffix from the sorted lms suffixes
+    std::fill(sa + lms_count, sa + n, -1);
+    bucket_bounds(counts, bounds, true);
+
+    for (auto i = lms_count; i-- > 0;) {
+        const auto j = sa[i];
+
+        sa[i] = -1;
+        sa[--bounds[s[j]]] = j;
+    }
+
+    induce();
+}
+} // namespace
+
+namespace {
+// the start of data's lexicographically least rotation, found through the
+// lyndon factorization of data repeated twice (Duval's algorithm)
+std::size_t least_rotation(const std::uint8_t *data, std::size_t size) {
+    const auto at = [&](std::size_t i) {
+        return data[i < size ? i : i - size];
+    };
+
+    std::size_t i{0};
+    std::size_t least{0};
+
+    while (i < size) {
+        least = i;
+
+        auto j = i + 1;
+        auto k = i;
+
+        while (j < 2 * size && at(k) <= at(j)) {
+            k = at(k) < at(j) ? i : k + 1;
+            j++;
+        }
+
+        while (i <= k) {
+            i += j - k;
+        }
+    }
+
+    return least;
+}
+
+// whether data isn't some shorter string repeated
+bool primitive(const std::uint8_t *data, std::size_t size) {
+    std::vector<std::size_t> border(size + 1, 0);
+
+    for (std::size_t i = 1, k = 0; i < size; i++) {
+        while (k > 0 && data[i] != data[k]) {
+            k = border[k];
+        }
+
+        if (data[i] == data[k]) {
+            k++;
+        }
+
+        border[i + 1] = k;
+    }
+
+    const auto period = size - border[size];
+    return period == size || size % period != 0;
+}
+} // namespace
+
+// Sorts the rotations of data, as the burrows-wheeler transform needs,
+// returning the starting index of each in order, in linear time even for
+// the highly repetitive data comparison based sorts struggle with. Starting
+// from its least rotation, data is a lyndon word unless it repeats, and the
+// rotations of a lyndon word are ordered just like its suffixes, so only
+// those need sorting. Otherwise the suffixes of data repeated twice are.
+std::vector<std::int32_t> sort_rotations(const std::uint8_t *data,
+                                         std::size_t size) {
+    const auto n = static_cast<std::int32_t>(size);
+
+    if (n == 0) {
+        return {};
+    }
+
+    const auto repeats = !primitive(data, size);
+    const auto shift = repeats ? 0 : least_rotation(data, size);
+    const auto length = repeats ? 2 * n : n;
+
+    // symbols shifted up by one, leaving 0 as the terminator
+    std::vector<std::uint16_t> text(length + 1);
+
+    for (std::int32_t i = 0; i < length; i++) {
+        text[i] = static_cast<std::uint16_t>(data[(shift + i) % size] + 1);
+    }
+
+    std::vector<std::int32_t> sa(text.size());
+    induced_sort(text.data(), sa.data(),
+                 static_cast<std::int32_t>(text.size()), 257);
+
+    std::vector<std::int32_t> rotations{};
+    rotations.reserve(size);
+
+    for (const auto suffix : sa) {
+        if (suffix < n) {
+            rotations.push_back(
+                static_cast<std::int32_t>((suffix + shift) % size));
+        }
+    }
+
+    return rotations;
+}
+} // namespace sysd::jag::detail
+
+#endif // SYSD_JAG_SUFFIX_ARRAY_HPP
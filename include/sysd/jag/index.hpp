@@ -0,0 +1,123 @@
+#ifndef SYSD_JAG_INDEX_HPP
+#define SYSD_JAG_INDEX_HPP
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <sysd/buffer.hpp>
+#include <sysd/jag/detail/decompressor.hpp>
+
+namespace sysd::jag {
+struct index_entry {
+    std::uint32_t name;
+    std::size_t decomp_len;
+    std::size_t comp_len;
+    // offset of the entry's data from the start of the archive's body
+    std::size_t offset;
+
+    bool compressed() const { return decomp_len != comp_len; }
+};
+
+// The layout of an archive, as described by its header and entry table,
+// without any of the entries' data.
+struct archive_index {
+    std::size_t decomp_len;
+    std::size_t comp_len;
+    std::vector<index_entry> entries{};
+
+    bool compressed() const { return decomp_len != comp_len; }
+};
+
+namespace detail {
+constexpr std::size_t archive_header_size = 6;
+constexpr std::size_t entry_record_size = 10;
+
+// the number of body bytes needed to hold the entry table, given at least the
+// first two bytes of a body starting at start
+std::size_t entry_table_length(const container_type &data,
+                               const std::size_t &start) {
+    if (data.size() < start + 2) {
+        throw std::runtime_error{"archive body is missing its entry count"};
+    }
+
+    sysd::buffer count{{data[start], data[start + 1]}};
+
+    return 2 + (count.read<2, std::size_t>() * entry_record_size);
+}
+
+// parses the entry table of a body starting at start within data
+void parse_entry_table(const container_type &data, const std::size_t &start,
+                       archive_index &index) {
+    const auto table_len = entry_table_length(data, start);
+
+    if (data.size() < start + table_len) {
+        throw std::runtime_error{"archive entry table is truncated"};
+    }
+
+    sysd::buffer table{container_type{std::begin(data) + start,
+                                      std::begin(data) + start + table_len}};
+    const auto file_count = table.read<2, std::size_t>();
+    std::size_t offset{table_len};
+
+    index.entries.reserve(file_count);
+
+    for (std::size_t i = 0; i < file_count; i++) {
+        const auto name = table.read<4, std::uint32_t>();
+        const auto decomp_len = table.read<3, std::size_t>();
+        const auto comp_len = table.read<3, std::size_t>();
+
+        index.entries.push_back({name, decomp_len, comp_len, offset});
+        offset += comp_len;
+    }
+}
+} // namespace detail
+
+namespace detail {
+// Reads an archive's index as read_index() does. When the body is compressed,
+// decoder is left holding the decoder used to reach the entry table, so the
+// rest of the body can be decoded without starting over.
+archive_index read_index(const container_type &data,
+                         std::unique_ptr<partial_decompressor> &decoder) {
+    if (data.size() < archive_header_size) {
+        throw std::runtime_error{"archive header is truncated"};
+    }
+
+    sysd::buffer header{container_type{
+        std::begin(data), std::begin(data) + archive_header_size}};
+
+    archive_index index{};
+    index.decomp_len = header.read<3, std::size_t>();
+    index.comp_len = header.read<3, std::size_t>();
+
+    if (!index.compressed()) {
+        parse_entry_table(data, archive_header_size, index);
+        return index;
+    }
+
+    decoder = std::make_unique<partial_decompressor>(
+        data, archive_header_size, index.decomp_len);
+
+    const auto &body = decoder->decode_until(2);
+    const auto table_len = entry_table_length(body, 0);
+
+    parse_entry_table(decoder->decode_until(table_len), 0, index);
+
+    return index;
+}
+} // namespace detail
+
+// Reads an archive's header and entry table. Entry data is never decoded, and
+// when the whole archive is compressed the body is only decoded as far as the
+// end of the entry table.
+archive_index read_index(const detail::container_type &data) {
+    std::unique_ptr<detail::partial_decompressor> decoder{};
+
+    return detail::read_index(data, decoder);
+}
+} // namespace sysd::jag
+
+#endif // SYSD_JAG_INDEX_HPP
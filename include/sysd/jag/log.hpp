@@ -0,0 +1,89 @@
+#ifndef SYSD_JAG_LOG_HPP
+#define SYSD_JAG_LOG_HPP
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include <spdlog/sinks/null_sink.h>
+#include <spdlog/spdlog.h>
+
+// Messages below this spdlog level are compiled out of the library entirely,
+// define it as 2 (info) or above to drop the per entry debug messages.
+#ifndef SYSD_JAG_LOG_LEVEL
+#define SYSD_JAG_LOG_LEVEL 0
+#endif
+
+namespace sysd::jag {
+namespace detail {
+constexpr auto min_log_level =
+    static_cast<spdlog::level::level_enum>(SYSD_JAG_LOG_LEVEL);
+
+std::shared_ptr<spdlog::logger> &logger_storage() {
+    static std::shared_ptr<spdlog::logger> logger{};
+    return logger;
+}
+
+std::atomic<spdlog::logger *> &active_logger() {
+    static std::atomic<spdlog::logger *> active{nullptr};
+    return active;
+}
+} // namespace detail
+
+// Sets the logger the library writes to. It should be set once, before the
+// library is used, and is then read without any locking. Until it is set the
+// library looks up the "jag" logger, or discards everything if there is none.
+void set_logger(std::shared_ptr<spdlog::logger> logger) {
+    detail::logger_storage() = std::move(logger);
+    detail::active_logger().store(detail::logger_storage().get(),
+                                  std::memory_order_release);
+}
+
+spdlog::logger &logger() {
+    if (auto *active = detail::active_logger().load(std::memory_order_acquire);
+        active != nullptr) {
+        return *active;
+    }
+
+    static const auto fallback = [] {
+        if (auto registered = spdlog::get("jag"); registered) {
+            return registered;
+        }
+
+        return std::make_shared<spdlog::logger>(
+            "jag", std::make_shared<spdlog::sinks::null_sink_mt>());
+    }();
+
+    return *fallback;
+}
+
+namespace detail {
+template <spdlog::level::level_enum L> bool should_log() {
+    if constexpr (L < min_log_level) {
+        return false;
+    } else {
+        return logger().should_log(L);
+    }
+}
+
+// Logs at a level fixed at compile time. Disabled levels cost a check of the
+// logger's level, or nothing at all when below SYSD_JAG_LOG_LEVEL.
+template <spdlog::level::level_enum L, typename... Args>
+void log(const char *fmt, const Args &... args) {
+    if (should_log<L>()) {
+        logger().log(L, fmt, args...);
+    }
+}
+
+template <typename... Args> void debug(const char *fmt, const Args &... args) {
+    log<spdlog::level::debug>(fmt, args...);
+}
+
+template <typename... Args> void warn(const char *fmt, const Args &... args) {
+    log<spdlog::level::warn>(fmt, args...);
+}
+} // namespace detail
+} // namespace sysd::jag
+
+#endif // SYSD_JAG_LOG_HPP
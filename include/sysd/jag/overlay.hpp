@@ -0,0 +1,124 @@
+#ifndef SYSD_JAG_OVERLAY_HPP
+#define SYSD_JAG_OVERLAY_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <sysd/buffer.hpp>
+#include <sysd/jag/archive.hpp>
+#include <sysd/jag/archive_view.hpp>
+#include <sysd/jag/detail/entry_encode.hpp>
+#include <sysd/jag/index.hpp>
+#include <sysd/jag/log.hpp>
+
+namespace sysd::jag {
+// Archives stacked on top of one another, such as patches over a base
+// archive, read as if they had been merged without rewriting any of them.
+// An entry is read from the highest layer holding it. Layers with a higher
+// priority sit above those with a lower one, and among equal priorities a
+// layer added later sits above those added before it.
+//
+// Nothing is resolved up front. get() asks each layer in turn, from the top,
+// and only the layer holding the entry decodes anything. flatten() merges the
+// layers into a single archive.
+struct overlay {
+    // where an entry lives
+    struct location {
+        // position of its layer, from the top
+        std::size_t layer;
+        index_entry entry;
+    };
+
+    void add(archive_view layer, const int priority = 0) {
+        const auto above = std::find_if(
+            std::begin(layers), std::end(layers),
+            [priority](const auto &l) { return l.priority <= priority; });
+
+        layers.insert(above, {std::move(layer), priority});
+    }
+
+    std::size_t layer_count() const { return layers.size(); }
+
+    // the layer at position i, from the top
+    archive_view &layer(std::size_t i) { return layers[i].view; }
+
+    boost::optional<location> find(const boost::string_view file) const {
+        return find(detail::encode_entry_name(file));
+    }
+
+    boost::optional<location> find(const std::uint32_t name) const {
+        for (std::size_t i = 0; i < layers.size(); i++) {
+            if (auto entry = layers[i].view.find(name); entry) {
+                return location{i, entry.value()};
+            }
+        }
+
+        return boost::none;
+    }
+
+    boost::optional<sysd::buffer> get(const boost::string_view file) {
+        return get(detail::encode_entry_name(file));
+    }
+
+    boost::optional<sysd::buffer> get(const std::uint32_t name) {
+        if (auto loc = find(name); loc) {
+            return read(loc.value());
+        }
+
+        return boost::none;
+    }
+
+    sysd::buffer read(const location &loc) {
+        return layers[loc.layer].view.read(loc.entry);
+    }
+
+    // Merges the layers into one archive, reading each entry once from the
+    // layer it resolves to. Entries keep the order of the lowest layer
+    // holding them, with entries new to a layer following those beneath it.
+    archive flatten() {
+        std::vector<std::uint32_t> order{};
+        std::unordered_map<std::uint32_t, location> resolved{};
+
+        for (auto i = layers.size(); i-- > 0;) {
+            for (const auto &entry : layers[i].view.index().entries) {
+                if (resolved.count(entry.name) == 0) {
+                    order.push_back(entry.name);
+                }
+
+                resolved.insert_or_assign(entry.name, location{i, entry});
+            }
+        }
+
+        archive merged{};
+        merged.reserve(order.size());
+
+        for (const auto name : order) {
+            auto data = read(resolved.at(name));
+            merged.append(name, data);
+        }
+
+        detail::debug("flattened {} layers into {} entries", layers.size(),
+                      order.size());
+
+        return merged;
+    }
+
+  private:
+    struct stacked {
+        archive_view view;
+        int priority;
+    };
+
+    // from the top
+    std::vector<stacked> layers{};
+};
+} // namespace sysd::jag
+
+#endif // SYSD_JAG_OVERLAY_HPP
@@ -3,52 +3,303 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <ostream>
 #include <tuple>
 #include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
 
 #include <sysd/buffer.hpp>
+#include <sysd/jag/access_profile.hpp>
 #include <sysd/jag/archive.hpp>
+#include <sysd/jag/checksum.hpp>
+#include <sysd/jag/compression_cache.hpp>
 #include <sysd/jag/detail/compressor.hpp>
+#include <sysd/jag/detail/estimate.hpp>
+#include <sysd/jag/index.hpp>
+#include <sysd/jag/log.hpp>
+#include <sysd/jag/stats.hpp>
+#include <sysd/jag/trace.hpp>
 
 namespace sysd::jag {
+// How the archive's data is compressed. The whole archive can be compressed
+// as one stream, or each entry can be compressed on its own and stored in an
+// uncompressed archive body. The engine understands both. automatic tries
+// both, as well as storing everything uncompressed, and keeps the smallest.
+enum class layout { archive, entries, automatic };
+
+struct serialize_options {
+    std::size_t threshold{archive::compression_threshold};
+    jag::layout layout{layout::archive};
+    // consulted before compressing anything, when set
+    compression_cache *cache{nullptr};
+    // lays out the entries read most often first, when set
+    const access_profile *access{nullptr};
+    // filled in with the checksums of the archive written and its entries,
+    // when set
+    archive_checksums *checksums{nullptr};
+    // groups similar entries together before the archive is compressed as a
+    // whole, which the format allows as entries are located via the table
+    bool reorder{false};
+    // skips compressing data that looks incompressible, rather than finding
+    // out the hard way
+    bool estimate{true};
+    // with the automatic layout, the longest it may take to decode every
+    // entry of the archive, or zero for no limit
+    std::chrono::nanoseconds decode_budget{0};
+    // trades compression time for smaller output
+    compression_level level{compression_level::normal};
+};
+
 namespace {
-template <typename T> auto compute_data_block(const T &entries) {
-    sysd::buffer buffer{};
+// an entry as it's written, either compressed on its own or stored as is
+struct entry_payload {
+    std::uint32_t name;
+    const detail::container_type *source;
+    detail::container_type compressed;
+    bool packed;
+
+    const detail::container_type &data() const {
+        return packed ? compressed : *source;
+    }
+};
+
+auto compress_with(const detail::container_type &data,
+                   const serialize_options &opts) {
+    if (opts.cache != nullptr) {
+        return opts.cache->compress(data, opts.level);
+    }
+
+    return detail::compress(data, opts.level);
+}
+
+boost::optional<detail::container_type>
+compress_entry(const std::uint32_t name, const detail::container_type &data,
+               const serialize_options &opts) {
+    if (opts.layout != layout::entries || data.size() < opts.threshold) {
+        return boost::none;
+    }
+
+    if (opts.estimate && !detail::likely_compressible(data)) {
+        detail::debug("\tentry {:08x} looks incompressible", name);
+        return boost::none;
+    }
+
+    detail::entry_span span{"compress", name, data.size()};
+    auto compressed = compress_with(data, opts);
+
+    // an entry whose compressed size equals its decompressed size would be
+    // read back as a stored entry, so compression must strictly pay off to
+    // be used
+    if (compressed.size() < data.size()) {
+        return compressed;
+    }
+
+    return boost::none;
+}
+
+// Sorts entries so that ones of a similar kind end up next to each other,
+// as bzip2 only finds redundancy within a block (100 KB at block size 1).
+// Text comes after binary data, binary data is grouped by its first four
+// bytes, which are usually a file format's magic number, and each group is
+// ordered by size.
+auto similarity_key(const detail::container_type &data) {
+    constexpr std::size_t sample_size = 256;
+    const auto sample = std::min(data.size(), sample_size);
+
+    const auto text = std::all_of(
+        std::begin(data), std::begin(data) + sample, [](const char ch) {
+            const auto c = static_cast<unsigned char>(ch);
+            return (c >= 0x20 && c < 0x7f) || c == '\n' || c == '\r' ||
+                   c == '\t';
+        });
+
+    const auto magic_size = text ? 0 : std::min(data.size(), std::size_t{4});
+    std::uint32_t magic{0};
+
+    for (std::size_t i = 0; i < magic_size; i++) {
+        magic |= static_cast<std::uint32_t>(data[i] & 0xff) << (24 - i * 8);
+    }
+
+    return std::make_tuple(text, magic, data.size());
+}
+
+// Reorders items by the similarity key of their data, given by data_of.
+// Keys are computed once per item, and items with equal keys keep their
+// order.
+template <typename T, typename F>
+void sort_by_similarity(std::vector<T> &items, F &&data_of) {
+    using key_type = decltype(similarity_key(data_of(items.front())));
+
+    std::vector<std::pair<key_type, std::size_t>> keyed{};
+    keyed.reserve(items.size());
+
+    for (std::size_t i = 0; i < items.size(); i++) {
+        keyed.emplace_back(similarity_key(data_of(items[i])), i);
+    }
+
+    // the index breaks ties, so this is stable
+    std::sort(std::begin(keyed), std::end(keyed));
+
+    std::vector<T> sorted{};
+    sorted.reserve(items.size());
+
+    for (const auto &[key, i] : keyed) {
+        sorted.push_back(std::move(items[i]));
+    }
+
+    items = std::move(sorted);
+}
+
+template <typename T>
+auto compute_payloads(const T &entries, const serialize_options &opts) {
+    std::vector<entry_payload> payloads{};
+    payloads.reserve(entries.size());
+
+    for (const auto &[name, buf] : entries) {
+        auto compressed = compress_entry(name, buf.data(), opts);
+        const auto packed = compressed.has_value();
+
+        payloads.push_back({name, &buf.data(),
+                            packed ? std::move(*compressed)
+                                   : detail::container_type{},
+                            packed});
+    }
+
+    if (opts.reorder && opts.layout == layout::archive) {
+        sort_by_similarity(payloads, [](const entry_payload &payload)
+                                         -> const detail::container_type & {
+            return *payload.source;
+        });
+    }
+
+    // entries which are read alike keep their similarity order
+    if (opts.access != nullptr) {
+        std::stable_sort(std::begin(payloads), std::end(payloads),
+                         [&opts](const auto &a, const auto &b) {
+                             return opts.access->hotter(a.name, b.name);
+                         });
+    }
+
+    return payloads;
+}
+// the order entries are written in when they're streamed, the same as
+// compute_payloads() would give them
+auto stream_order(const std::vector<archive::entry_type> &entries,
+                  const serialize_options &opts) {
+    std::vector<const archive::entry_type *> order{};
+    order.reserve(entries.size());
 
     for (const auto &entry : entries) {
-        const auto &buf = std::get<sysd::buffer>(entry);
+        order.push_back(&entry);
+    }
+
+    if (opts.reorder && opts.layout == layout::archive) {
+        sort_by_similarity(order, [](const archive::entry_type *entry)
+                                      -> const detail::container_type & {
+            return std::get<sysd::buffer>(*entry).data();
+        });
+    }
+
+    if (opts.access != nullptr) {
+        std::stable_sort(std::begin(order), std::end(order),
+                         [&opts](const auto *a, const auto *b) {
+                             return opts.access->hotter(
+                                 std::get<std::uint32_t>(*a),
+                                 std::get<std::uint32_t>(*b));
+                         });
+    }
+
+    return order;
+}
+auto compute_data_block(const std::vector<entry_payload> &payloads) {
+    sysd::buffer buffer{};
 
-        buffer.write(buf);
+    for (const auto &payload : payloads) {
+        buffer.write(payload.data());
     }
 
     return buffer;
 }
-template <typename T> auto compute_info_block(const T &entries) {
+auto compute_records(const std::vector<entry_payload> &payloads) {
+    std::vector<index_entry> records{};
+    records.reserve(payloads.size());
+
+    auto offset = 2 + payloads.size() * detail::entry_record_size;
+
+    for (const auto &payload : payloads) {
+        records.push_back({payload.name, payload.source->size(),
+                           payload.data().size(), offset});
+        offset += payload.data().size();
+    }
+
+    return records;
+}
+auto compute_info_block(const std::vector<index_entry> &records) {
     sysd::buffer buffer{};
 
-    buffer.write<2, std::size_t>(entries.size());
+    buffer.write<2, std::size_t>(records.size());
 
-    for (const auto &entry : entries) {
-        const auto &[name, buf] = entry;
+    for (const auto &record : records) {
+        buffer.write<4, std::size_t>(record.name);
+        buffer.write<3, std::size_t>(record.decomp_len);
+        buffer.write<3, std::size_t>(record.comp_len);
+    }
 
-        buffer.write<4, std::size_t>(name);
-        buffer.write<3, std::size_t>(buf.data().size());
-        buffer.write<3, std::size_t>(buf.data().size());
+    return buffer;
+}
+auto compute_body_length(const std::vector<entry_payload> &payloads) {
+    auto length = 2 + payloads.size() * detail::entry_record_size;
+
+    for (const auto &payload : payloads) {
+        length += payload.data().size();
     }
 
+    return length;
+}
+auto compute_header(const std::size_t decomp_len, const std::size_t comp_len) {
+    sysd::buffer buffer{};
+
+    buffer.write<3, std::size_t>(decomp_len);
+    buffer.write<3, std::size_t>(comp_len);
+
     return buffer;
 }
+void write_to(std::ostream &out, const sysd::buffer &buffer) {
+    out.write(buffer.data().data(), buffer.data().size());
+}
+auto compute_entry_checksums(const std::vector<entry_payload> &payloads) {
+    std::vector<entry_checksum> sums{};
+    sums.reserve(payloads.size());
+
+    for (const auto &payload : payloads) {
+        sums.push_back({payload.name, compute_checksum(*payload.source)});
+    }
+
+    return sums;
+}
+
+const sysd::buffer serialize_best(const archive &arc,
+                                  const serialize_options &opts);
 } // namespace
 
-const sysd::buffer serialize(const archive &arc, std::size_t threshold) {
-    const auto &entries = arc.get_entries();
-    const auto info_block = compute_info_block(entries);
-    const auto data_block = compute_data_block(entries);
+const sysd::buffer serialize(const archive &arc,
+                             const serialize_options &opts) {
+    if (opts.layout == layout::automatic) {
+        return serialize_best(arc, opts);
+    }
+
+    detail::phase_scope scope{phase::serialize};
+    const auto payloads = compute_payloads(arc.get_entries(), opts);
 
     sysd::buffer body{};
 
-    body.write(std::move(info_block));
-    body.write(std::move(data_block));
+    body.write(compute_info_block(compute_records(payloads)));
+    body.write(compute_data_block(payloads));
 
     // The jag format consists of ia 6 byte header, the first
     // 3 bytes are the archive's decompressed size, and the
@@ -58,19 +309,202 @@ const sysd::buffer serialize(const archive &arc, std::size_t threshold) {
     auto decompressed_size = body.data().size();
     auto compressed_size = decompressed_size;
 
-    if (decompressed_size >= threshold) {
-        body = sysd::buffer{detail::compress(body.data())};
-        compressed_size = body.data().size();
+    auto compress_body =
+        opts.layout == layout::archive && decompressed_size >= opts.threshold;
+
+    if (compress_body && opts.estimate &&
+        !detail::likely_compressible(body.data())) {
+        detail::debug("archive looks incompressible, storing it");
+        compress_body = false;
     }
 
-    sysd::buffer buffer{};
+    if (compress_body) {
+        body = sysd::buffer{compress_with(body.data(), opts)};
+        compressed_size = body.data().size();
+    }
 
-    buffer.write<3, std::size_t>(decompressed_size);
-    buffer.write<3, std::size_t>(compressed_size);
+    auto buffer = compute_header(decompressed_size, compressed_size);
     buffer.write(body);
 
+    if (opts.checksums != nullptr) {
+        opts.checksums->archive = compute_checksum(buffer.data());
+        opts.checksums->entries = compute_entry_checksums(payloads);
+    }
+
+    scope.entries(payloads.size());
+    scope.bytes_in(decompressed_size);
+    scope.bytes_out(buffer.data().size());
     return buffer;
 }
+
+// Writes the archive to out as it's serialized, and returns the number of
+// bytes written. When the body isn't compressed as a whole and out can seek,
+// entries are compressed and written one at a time, so no more than one
+// compressed entry is held at once: the entry table is written as a
+// placeholder and filled in once every entry's size is known. Otherwise the
+// compressed entries, or the whole archive, are built in memory first. That's
+// also the case when checksums are wanted, so the archive is checksummed in
+// the order it's written.
+std::size_t serialize(const archive &arc, std::ostream &out,
+                      const serialize_options &opts) {
+    const auto &entries = arc.get_entries();
+    const auto table_len = 2 + entries.size() * detail::entry_record_size;
+    auto raw_len = table_len;
+
+    for (const auto &[name, buf] : entries) {
+        raw_len += buf.data().size();
+    }
+
+    if (opts.layout == layout::automatic ||
+        (opts.layout == layout::archive && raw_len >= opts.threshold)) {
+        const auto buffer = serialize(arc, opts);
+
+        write_to(out, buffer);
+        return buffer.data().size();
+    }
+
+    detail::phase_scope scope{phase::serialize};
+    const auto start = out.tellp();
+    scope.entries(entries.size());
+
+    if (start == std::ostream::pos_type(-1) || opts.checksums != nullptr) {
+        const auto payloads = compute_payloads(entries, opts);
+        const auto body_len = compute_body_length(payloads);
+        checksummer sums{};
+
+        const auto write = [&out, &sums](const detail::container_type &data) {
+            out.write(data.data(), data.size());
+            sums.update(data);
+        };
+
+        write(compute_header(body_len, body_len).data());
+        write(compute_info_block(compute_records(payloads)).data());
+
+        for (const auto &payload : payloads) {
+            write(payload.data());
+        }
+
+        if (opts.checksums != nullptr) {
+            opts.checksums->archive = sums.finish();
+            opts.checksums->entries = compute_entry_checksums(payloads);
+        }
+
+        scope.bytes_in(raw_len);
+        scope.bytes_out(detail::archive_header_size + body_len);
+        return detail::archive_header_size + body_len;
+    }
+
+    const detail::container_type placeholder(
+        detail::archive_header_size + table_len, 0);
+
+    out.write(placeholder.data(), placeholder.size());
+
+    std::vector<index_entry> records{};
+    records.reserve(entries.size());
+    auto body_len = table_len;
+
+    for (const auto *entry : stream_order(entries, opts)) {
+        const auto &[name, buf] = *entry;
+        auto compressed = compress_entry(name, buf.data(), opts);
+        const auto &data = compressed ? *compressed : buf.data();
+
+        out.write(data.data(), data.size());
+        records.push_back({name, buf.data().size(), data.size(), body_len});
+        body_len += data.size();
+    }
+
+    const auto end = out.tellp();
+
+    out.seekp(start);
+    write_to(out, compute_header(body_len, body_len));
+    write_to(out, compute_info_block(records));
+    out.seekp(end);
+
+    scope.bytes_in(raw_len);
+    scope.bytes_out(detail::archive_header_size + body_len);
+    return detail::archive_header_size + body_len;
+}
+
+namespace {
+// the time taken to decode every entry of a serialized archive
+auto decode_time(const sysd::buffer &data) {
+    using clock = std::chrono::steady_clock;
+
+    sysd::buffer copy{data};
+    const auto begin = clock::now();
+    const archive decoded{copy};
+
+    return clock::now() - begin;
+}
+
+const char *layout_name(const layout l) {
+    switch (l) {
+    case layout::archive:
+        return "archive";
+    case layout::entries:
+        return "entries";
+    case layout::automatic:
+        return "automatic";
+    }
+
+    return "unknown";
+}
+
+// Serializes the archive compressed as a whole, with each entry compressed
+// on its own, and with everything stored, then keeps the smallest which
+// decodes within the budget. Storing everything always fits the budget.
+const sysd::buffer serialize_best(const archive &arc,
+                                  const serialize_options &opts) {
+    archive_checksums best_sums{};
+    archive_checksums candidate_sums{};
+
+    auto stored_opts = opts;
+    stored_opts.layout = layout::entries;
+    stored_opts.threshold = std::numeric_limits<std::size_t>::max();
+    stored_opts.checksums = opts.checksums ? &best_sums : nullptr;
+
+    auto best = serialize(arc, stored_opts);
+    auto best_layout = "stored";
+
+    for (const auto candidate : {layout::archive, layout::entries}) {
+        auto candidate_opts = opts;
+        candidate_opts.layout = candidate;
+        candidate_opts.checksums = opts.checksums ? &candidate_sums : nullptr;
+
+        auto data = serialize(arc, candidate_opts);
+
+        if (data.data().size() >= best.data().size()) {
+            continue;
+        }
+
+        if (opts.decode_budget.count() > 0 &&
+            decode_time(data) > opts.decode_budget) {
+            detail::debug("{} layout decodes over budget",
+                          layout_name(candidate));
+            continue;
+        }
+
+        best = std::move(data);
+        best_sums = std::move(candidate_sums);
+        best_layout = layout_name(candidate);
+    }
+
+    if (opts.checksums != nullptr) {
+        *opts.checksums = std::move(best_sums);
+    }
+
+    detail::debug("chose {} layout, {} bytes", best_layout,
+                  best.data().size());
+    return best;
+}
+} // namespace
+
+const sysd::buffer serialize(const archive &arc, std::size_t threshold) {
+    serialize_options opts{};
+    opts.threshold = threshold;
+
+    return serialize(arc, opts);
+}
 } // namespace sysd::jag
 
 #endif // SYSD_JAG_SERIALIZE_HPP
@@ -0,0 +1,223 @@
+#ifndef SYSD_JAG_SIDECAR_HPP
+#define SYSD_JAG_SIDECAR_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+
+#include <sysd/buffer.hpp>
+#include <sysd/jag/archive.hpp>
+#include <sysd/jag/archive_view.hpp>
+#include <sysd/jag/detail/hash.hpp>
+#include <sysd/jag/index.hpp>
+
+namespace sysd::jag {
+struct sidecar_entry : index_entry {
+    // content hash of the entry's decompressed data
+    std::uint64_t hash;
+};
+
+// An archive's index kept next to it in <archive>.jagidx, so the archive can
+// be opened and questions about its contents answered without decoding it.
+// Besides the entry table, a sidecar records the size, modification time and
+// content hash of the archive file it was made for, and is only trusted while
+// those still match.
+//
+// The file is a 50 byte header followed by a 24 byte record per entry:
+//
+//   header: 4 bytes magic, 2 bytes version, 8 bytes source size,
+//           8 bytes source mtime, 8 bytes source hash, 4 bytes archive
+//           decompressed size, 4 bytes archive compressed size, 8 bytes
+//           reserved, 4 bytes entry count
+//   entry:  4 bytes name, 4 bytes decompressed size, 4 bytes compressed
+//           size, 4 bytes body offset, 8 bytes content hash
+struct sidecar {
+    static constexpr std::uint32_t magic = 0x4a494458; // "JIDX"
+    static constexpr std::uint16_t version = 2;
+    static constexpr std::size_t header_size = 50;
+    static constexpr std::size_t record_size = 24;
+
+    std::uint64_t source_size{0};
+    std::int64_t source_mtime{0};
+    std::uint64_t source_hash{0};
+    std::size_t decomp_len{0};
+    std::size_t comp_len{0};
+    std::vector<sidecar_entry> entries{};
+
+    boost::optional<const sidecar_entry &> find(std::uint32_t name) const {
+        for (const auto &entry : entries) {
+            if (entry.name == name) {
+                return entry;
+            }
+        }
+
+        return boost::none;
+    }
+
+    // whether this sidecar describes the given archive file's contents
+    bool describes(const detail::container_type &archive_data) const {
+        return source_size == archive_data.size() &&
+               source_hash == detail::content_hash(archive_data);
+    }
+
+    // a cheap check, true when the archive file looks the same as when the
+    // sidecar was written without reading it
+    bool matches(const boost::filesystem::path &archive) const {
+        boost::system::error_code ec{};
+
+        const auto size = boost::filesystem::file_size(archive, ec);
+
+        if (ec || size != source_size) {
+            return false;
+        }
+
+        const auto mtime = boost::filesystem::last_write_time(archive, ec);
+
+        return !ec && mtime == source_mtime;
+    }
+
+    archive_index to_index() const {
+        archive_index index{};
+
+        index.decomp_len = decomp_len;
+        index.comp_len = comp_len;
+        index.entries.assign(std::begin(entries), std::end(entries));
+
+        return index;
+    }
+};
+
+boost::filesystem::path sidecar_path(const boost::filesystem::path &archive) {
+    auto path = archive;
+    path += ".jagidx";
+
+    return path;
+}
+
+sidecar make_sidecar(const archive &arc,
+                     const detail::container_type &archive_data,
+                     const std::int64_t &archive_mtime) {
+    std::unordered_map<std::uint32_t, std::uint64_t> hashes{};
+
+    for (const auto &[name, buf] : arc.get_entries()) {
+        hashes.emplace(name, detail::content_hash(buf.data()));
+    }
+
+    const auto index = read_index(archive_data);
+
+    sidecar result{};
+
+    result.source_size = archive_data.size();
+    result.source_mtime = archive_mtime;
+    result.source_hash = detail::content_hash(archive_data);
+    result.decomp_len = index.decomp_len;
+    result.comp_len = index.comp_len;
+    result.entries.reserve(index.entries.size());
+
+    for (const auto &entry : index.entries) {
+        result.entries.push_back({entry, hashes[entry.name]});
+    }
+
+    return result;
+}
+
+boost::optional<sidecar> read_sidecar(const boost::filesystem::path &file) {
+    std::ifstream in{file.string(), std::ios::binary};
+
+    if (!in.is_open()) {
+        return boost::none;
+    }
+
+    sysd::buffer buffer{detail::container_type{
+        std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}}};
+
+    if (buffer.data().size() < sidecar::header_size ||
+        buffer.read<4, std::uint32_t>() != sidecar::magic ||
+        buffer.read<2, std::uint16_t>() != sidecar::version) {
+        return boost::none;
+    }
+
+    sidecar result{};
+
+    result.source_size = buffer.read<8, std::uint64_t>();
+    result.source_mtime =
+        static_cast<std::int64_t>(buffer.read<8, std::uint64_t>());
+    result.source_hash = buffer.read<8, std::uint64_t>();
+    result.decomp_len = buffer.read<4, std::size_t>();
+    result.comp_len = buffer.read<4, std::size_t>();
+    buffer.read<8, std::uint64_t>();
+
+    const auto count = buffer.read<4, std::size_t>();
+
+    if (buffer.data().size() !=
+        sidecar::header_size + (count * sidecar::record_size)) {
+        return boost::none;
+    }
+
+    result.entries.reserve(count);
+
+    for (std::size_t i = 0; i < count; i++) {
+        sidecar_entry entry{};
+
+        entry.name = buffer.read<4, std::uint32_t>();
+        entry.decomp_len = buffer.read<4, std::size_t>();
+        entry.comp_len = buffer.read<4, std::size_t>();
+        entry.offset = buffer.read<4, std::size_t>();
+        entry.hash = buffer.read<8, std::uint64_t>();
+
+        result.entries.push_back(entry);
+    }
+
+    return result;
+}
+
+bool write_sidecar(const boost::filesystem::path &file, const sidecar &sc) {
+    sysd::buffer buffer{};
+
+    buffer.write<4, std::uint32_t>(sidecar::magic);
+    buffer.write<2, std::uint16_t>(sidecar::version);
+    buffer.write<8, std::uint64_t>(sc.source_size);
+    buffer.write<8, std::uint64_t>(sc.source_mtime);
+    buffer.write<8, std::uint64_t>(sc.source_hash);
+    buffer.write<4, std::size_t>(sc.decomp_len);
+    buffer.write<4, std::size_t>(sc.comp_len);
+    buffer.write<8, std::uint64_t>(0);
+    buffer.write<4, std::size_t>(sc.entries.size());
+
+    for (const auto &entry : sc.entries) {
+        buffer.write<4, std::uint32_t>(entry.name);
+        buffer.write<4, std::size_t>(entry.decomp_len);
+        buffer.write<4, std::size_t>(entry.comp_len);
+        buffer.write<4, std::size_t>(entry.offset);
+        buffer.write<8, std::uint64_t>(entry.hash);
+    }
+
+    std::ofstream out{file.string(), std::ios::trunc | std::ios::binary};
+    out.write(buffer.data().data(), buffer.data().size());
+
+    return static_cast<bool>(out);
+}
+// Opens a view of an archive, taking its index from the archive's sidecar
+// when it has an up to date one rather than parsing, and possibly decoding,
+// the archive's entry table.
+archive_view open_view(const boost::filesystem::path &archive,
+                       detail::container_type data) {
+    if (auto side = read_sidecar(sidecar_path(archive)); side) {
+        if (side->describes(data)) {
+            return archive_view{std::move(data), side->to_index()};
+        }
+    }
+
+    return archive_view{std::move(data)};
+}
+} // namespace sysd::jag
+
+#endif // SYSD_JAG_SIDECAR_HPP
@@ -0,0 +1,174 @@
+#ifndef SYSD_JAG_STATS_HPP
+#define SYSD_JAG_STATS_HPP
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <sys/resource.h>
+
+#include <sysd/jag/detail/alloc_counter.hpp>
+#include <sysd/jag/trace.hpp>
+
+namespace sysd::jag {
+// The phases archive operations are broken down into. Phases may nest, such
+// as entries being decompressed while unpacking an archive, in which case
+// the time is counted towards both.
+enum class phase : std::size_t {
+    read_file,
+    decompress,
+    unpack,
+    serialize,
+    compress,
+    write_file,
+    count
+};
+
+constexpr std::size_t phase_count = static_cast<std::size_t>(phase::count);
+
+constexpr const char *phase_name(phase p) {
+    constexpr const char *names[] = {"read_file", "decompress", "unpack",
+                                     "serialize", "compress",   "write_file"};
+
+    return names[static_cast<std::size_t>(p)];
+}
+
+// Counters for a single phase. They may be updated from several threads at
+// once, in which case time is the sum of the time spent on every thread.
+struct phase_stats {
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> nanos{0};
+    std::atomic<std::uint64_t> bytes_in{0};
+    std::atomic<std::uint64_t> bytes_out{0};
+    std::atomic<std::uint64_t> entries{0};
+    // the process' peak resident set size in KiB when the phase last ended
+    std::atomic<std::uint64_t> peak_rss{0};
+    // only counted when built with allocation tracking
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> allocated_bytes{0};
+};
+
+struct stats {
+    std::array<phase_stats, phase_count> phases{};
+
+    phase_stats &operator[](phase p) {
+        return phases[static_cast<std::size_t>(p)];
+    }
+    const phase_stats &operator[](phase p) const {
+        return phases[static_cast<std::size_t>(p)];
+    }
+};
+
+namespace detail {
+// the stats instrumented code records into, if any
+std::atomic<stats *> &active_stats() {
+    static std::atomic<stats *> active{nullptr};
+    return active;
+}
+
+std::uint64_t peak_rss() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+
+    return static_cast<std::uint64_t>(usage.ru_maxrss);
+}
+
+void update_max(std::atomic<std::uint64_t> &value, std::uint64_t candidate) {
+    auto current = value.load();
+
+    while (current < candidate &&
+           !value.compare_exchange_weak(current, candidate)) {
+    }
+}
+
+// Measures a phase for as long as it is in scope, recording it into the
+// active stats and as a span of the active tracer. When neither is active
+// this costs two atomic loads.
+struct phase_scope {
+    explicit phase_scope(phase p, std::uint64_t bytes_in = 0)
+        : target{active_stats().load(std::memory_order_acquire)},
+          trace{active_tracer().load(std::memory_order_acquire)}, p{p},
+          in{bytes_in} {
+        if (target != nullptr || trace != nullptr) {
+            begin = std::chrono::steady_clock::now();
+            allocs = thread_alloc_counts();
+        }
+    }
+
+    phase_scope(const phase_scope &) = delete;
+    phase_scope &operator=(const phase_scope &) = delete;
+
+    ~phase_scope() {
+        if (target == nullptr && trace == nullptr) {
+            return;
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+        const auto &allocs_now = thread_alloc_counts();
+        const auto alloc_count = allocs_now.count - allocs.count;
+        const auto alloc_bytes = allocs_now.bytes - allocs.bytes;
+
+        if (trace != nullptr) {
+            trace->record(phase_name(p), "phase", begin, end, thread_index(),
+                          fmt::format("\"bytes_in\":{},\"bytes_out\":{},"
+                                      "\"entries\":{},\"allocations\":{},"
+                                      "\"allocated_bytes\":{}",
+                                      in, out, count, alloc_count,
+                                      alloc_bytes));
+        }
+
+        if (target == nullptr) {
+            return;
+        }
+
+        const auto elapsed = end - begin;
+        auto &phase = (*target)[p];
+
+        phase.calls++;
+        phase.nanos +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                .count();
+        phase.bytes_in += in;
+        phase.bytes_out += out;
+        phase.entries += count;
+        phase.allocations += alloc_count;
+        phase.allocated_bytes += alloc_bytes;
+        update_max(phase.peak_rss, peak_rss());
+    }
+
+    void bytes_in(std::uint64_t n) { in += n; }
+    void bytes_out(std::uint64_t n) { out += n; }
+    void entries(std::uint64_t n) { count += n; }
+
+  private:
+    stats *target;
+    tracer *trace;
+    phase p;
+    std::uint64_t in;
+    std::uint64_t out{0};
+    std::uint64_t count{0};
+    std::chrono::steady_clock::time_point begin{};
+    alloc_counts allocs{0, 0};
+};
+} // namespace detail
+
+// Directs everything instrumented to record into s while in scope, replacing
+// whatever was recording before. A null s stops recording altogether.
+struct stats_scope {
+    explicit stats_scope(stats *s)
+        : previous{detail::active_stats().exchange(s)} {}
+
+    stats_scope(const stats_scope &) = delete;
+    stats_scope &operator=(const stats_scope &) = delete;
+
+    ~stats_scope() { detail::active_stats().store(previous); }
+
+  private:
+    stats *previous;
+};
+} // namespace sysd::jag
+
+#endif // SYSD_JAG_STATS_HPP
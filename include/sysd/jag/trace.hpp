@@ -0,0 +1,193 @@
+#ifndef SYSD_JAG_TRACE_HPP
+#define SYSD_JAG_TRACE_HPP
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace sysd::jag {
+namespace detail {
+std::string json_escape(const std::string &str) {
+    std::string escaped{};
+    escaped.reserve(str.size());
+
+    for (const auto ch : str) {
+        if (ch == '"' || ch == '\\') {
+            escaped += '\\';
+            escaped += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            escaped += fmt::format("\\u{:04x}", static_cast<int>(ch));
+        } else {
+            escaped += ch;
+        }
+    }
+
+    return escaped;
+}
+} // namespace detail
+
+// Records spans of work as Chrome trace events, which can be loaded into
+// chrome://tracing or Perfetto. Events may be recorded from any thread, each
+// is tagged with a small per-thread id so work spread over a pool of workers
+// shows up as one track per worker.
+struct tracer {
+    using clock = std::chrono::steady_clock;
+
+    tracer() : origin{clock::now()} {}
+
+    tracer(const tracer &) = delete;
+    tracer &operator=(const tracer &) = delete;
+
+    // args must be the members of a JSON object, without the braces
+    void record(std::string name, const char *category,
+                clock::time_point begin, clock::time_point end,
+                std::uint32_t thread, std::string args) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        events.push_back({std::move(name), category, micros(begin),
+                          micros(end) - micros(begin), thread,
+                          std::move(args)});
+    }
+
+    void write(std::ostream &out) const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        out << "{\"traceEvents\":[";
+
+        for (std::size_t i = 0; i < events.size(); i++) {
+            const auto &event = events[i];
+
+            out << (i > 0 ? ",\n" : "\n")
+                << fmt::format("{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\","
+                               "\"ts\":{},\"dur\":{},\"pid\":1,\"tid\":{},"
+                               "\"args\":{{{}}}}}",
+                               detail::json_escape(event.name),
+                               event.category, event.begin,
+                               event.duration, event.thread, event.args);
+        }
+
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+  private:
+    struct event {
+        std::string name;
+        const char *category;
+        std::int64_t begin;
+        std::int64_t duration;
+        std::uint32_t thread;
+        std::string args;
+    };
+
+    clock::time_point origin;
+    mutable std::mutex mutex{};
+    std::vector<event> events{};
+
+    std::int64_t micros(clock::time_point time) const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time -
+                                                                     origin)
+            .count();
+    }
+};
+
+namespace detail {
+// the tracer instrumented code records into, if any
+std::atomic<tracer *> &active_tracer() {
+    static std::atomic<tracer *> active{nullptr};
+    return active;
+}
+
+// a small, stable id for the calling thread, in the order threads first
+// record something
+std::uint32_t thread_index() {
+    static std::atomic<std::uint32_t> next{1};
+    thread_local const std::uint32_t index = next++;
+
+    return index;
+}
+
+// Records a span from its construction until it goes out of scope.
+struct span {
+    span(const char *category, std::string name)
+        : target{active_tracer().load(std::memory_order_acquire)},
+          category{category}, name{std::move(name)} {
+        if (target != nullptr) {
+            begin = tracer::clock::now();
+        }
+    }
+
+    span(const span &) = delete;
+    span &operator=(const span &) = delete;
+
+    ~span() {
+        if (target != nullptr) {
+            target->record(std::move(name), category, begin,
+                           tracer::clock::now(), thread_index(), "");
+        }
+    }
+
+  private:
+    tracer *target;
+    const char *category;
+    std::string name;
+    tracer::clock::time_point begin{};
+};
+
+// Spans work done on a single entry, such as it being decoded. Unlike span,
+// nothing is formatted unless a tracer is active, so it is cheap enough to
+// use once per entry.
+struct entry_span {
+    entry_span(const char *what, std::uint32_t entry, std::size_t size)
+        : target{active_tracer().load(std::memory_order_acquire)}, what{what},
+          entry{entry}, size{size} {
+        if (target != nullptr) {
+            begin = tracer::clock::now();
+        }
+    }
+
+    entry_span(const entry_span &) = delete;
+    entry_span &operator=(const entry_span &) = delete;
+
+    ~entry_span() {
+        if (target != nullptr) {
+            target->record(fmt::format("{} {:08x}", what, entry), "entry",
+                           begin, tracer::clock::now(), thread_index(),
+                           fmt::format("\"name\":{},\"size\":{}", entry,
+                                       size));
+        }
+    }
+
+  private:
+    tracer *target;
+    const char *what;
+    std::uint32_t entry;
+    std::size_t size;
+    tracer::clock::time_point begin{};
+};
+} // namespace detail
+
+// Directs every span to be recorded into t while in scope, replacing whatever
+// was recording before. A null t stops tracing altogether.
+struct trace_scope {
+    explicit trace_scope(tracer *t)
+        : previous{detail::active_tracer().exchange(t)} {}
+
+    trace_scope(const trace_scope &) = delete;
+    trace_scope &operator=(const trace_scope &) = delete;
+
+    ~trace_scope() { detail::active_tracer().store(previous); }
+
+  private:
+    tracer *previous;
+};
+} // namespace sysd::jag
+
+#endif // SYSD_JAG_TRACE_HPP
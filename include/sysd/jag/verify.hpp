@@ -0,0 +1,155 @@
+#ifndef SYSD_JAG_VERIFY_HPP
+#define SYSD_JAG_VERIFY_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <sysd/buffer.hpp>
+#include <sysd/jag/checksum.hpp>
+#include <sysd/jag/detail/decompressor.hpp>
+#include <sysd/jag/detail/parallel.hpp>
+#include <sysd/jag/index.hpp>
+
+namespace sysd::jag {
+// What checking an archive found wrong with it, one problem per failed check.
+struct verify_result {
+    std::vector<std::string> problems{};
+    // the number of entries whose data was checked
+    std::size_t entries{0};
+
+    bool ok() const { return problems.empty(); }
+};
+
+// Checks that an archive can be read back exactly as its header and entry
+// table describe: the header's sizes match the file, the body decodes to its
+// declared length, every entry lies within the body and decodes to its own
+// declared length. With a manifest, the archive and its entries must also
+// match their checksums, listed under name as write_checksums() does.
+// Entries are decoded on up to jobs threads.
+verify_result verify_archive(const std::string &name,
+                             const detail::container_type &data,
+                             const std::size_t jobs,
+                             const checksum_manifest *manifest = nullptr) {
+    verify_result result{};
+    std::mutex result_mutex{};
+
+    const auto problem = [&](const std::string &what) {
+        std::lock_guard<std::mutex> lock{result_mutex};
+        result.problems.push_back(what);
+    };
+
+    const auto check = [&](const std::string &file, const checksum &actual) {
+        const auto expected = manifest->find(file);
+
+        if (expected == std::end(*manifest)) {
+            problem(fmt::format("{} isn't in the checksum manifest", file));
+        } else if (expected->second != actual) {
+            problem(fmt::format("{} doesn't match its checksum", file));
+        }
+    };
+
+    if (manifest != nullptr) {
+        check(name, compute_checksum(data));
+    }
+
+    if (data.size() < detail::archive_header_size) {
+        problem("archive header is truncated");
+        return result;
+    }
+
+    sysd::buffer header{detail::container_type{
+        std::begin(data), std::begin(data) + detail::archive_header_size}};
+
+    const auto decomp_len = header.read<3, std::size_t>();
+    const auto comp_len = header.read<3, std::size_t>();
+    const auto body_len = data.size() - detail::archive_header_size;
+
+    if (comp_len != body_len) {
+        problem(fmt::format("header says the body is {} bytes, it's {}",
+                            comp_len, body_len));
+        return result;
+    }
+
+    detail::container_type body{};
+
+    if (decomp_len == comp_len) {
+        body.assign(std::begin(data) + detail::archive_header_size,
+                    std::end(data));
+    } else {
+        try {
+            body = detail::decompress(data, detail::archive_header_size,
+                                      decomp_len);
+        } catch (const std::exception &e) {
+            problem(fmt::format("body doesn't decode: {}", e.what()));
+            return result;
+        }
+    }
+
+    archive_index index{decomp_len, comp_len, {}};
+
+    try {
+        detail::parse_entry_table(body, 0, index);
+    } catch (const std::exception &e) {
+        problem(e.what());
+        return result;
+    }
+
+    std::unordered_set<std::uint32_t> names{};
+
+    for (const auto &entry : index.entries) {
+        if (!names.insert(entry.name).second) {
+            problem(fmt::format("entry {:08x} appears more than once",
+                                entry.name));
+        }
+    }
+
+    const auto table_problems = result.problems.size();
+
+    detail::parallel_for(index.entries.size(), jobs, [&](std::size_t i) {
+        const auto &entry = index.entries[i];
+
+        if (entry.offset + entry.comp_len > body.size()) {
+            problem(fmt::format("entry {:08x} runs past the end of the body",
+                                entry.name));
+            return;
+        }
+
+        const auto begin = std::begin(body) + entry.offset;
+        detail::container_type packed(begin, begin + entry.comp_len);
+
+        if (entry.compressed()) {
+            try {
+                packed = detail::decompress(packed, 0, entry.decomp_len);
+            } catch (const std::exception &e) {
+                problem(fmt::format("entry {:08x} doesn't decode: {}",
+                                    entry.name, e.what()));
+                return;
+            }
+        }
+
+        if (manifest != nullptr) {
+            check(fmt::format("{}:{:08x}", name, entry.name),
+                  compute_checksum(packed));
+        }
+
+        std::lock_guard<std::mutex> lock{result_mutex};
+        result.entries++;
+    });
+
+    // in the same order whichever threads found them
+    std::sort(std::begin(result.problems) + table_problems,
+              std::end(result.problems));
+
+    return result;
+}
+} // namespace sysd::jag
+
+#endif // SYSD_JAG_VERIFY_HPP
@@ -0,0 +1,87 @@
+// Replaces the global allocation functions with ones that count how many
+// allocations are made, and how many bytes they request, on each thread. Only
+// built when configured with -DJAG_TRACK_ALLOCATIONS=ON.
+#include <cstdlib>
+#include <new>
+
+#include <sysd/jag/detail/alloc_counter.hpp>
+
+namespace {
+void *counted_alloc(std::size_t size) {
+    auto &counts = sysd::jag::detail::thread_alloc_counts();
+
+    counts.count++;
+    counts.bytes += size;
+
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void *counted_aligned_alloc(std::size_t size, std::align_val_t align) {
+    const auto alignment = static_cast<std::size_t>(align);
+    auto &counts = sysd::jag::detail::thread_alloc_counts();
+
+    counts.count++;
+    counts.bytes += size;
+
+    // aligned_alloc requires the size to be a multiple of the alignment
+    const auto rounded = ((size > 0 ? size : 1) + alignment - 1) &
+                         ~(alignment - 1);
+
+    return std::aligned_alloc(alignment, rounded);
+}
+} // namespace
+
+void *operator new(std::size_t size) {
+    if (auto *ptr = counted_alloc(size); ptr != nullptr) {
+        return ptr;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return counted_alloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return counted_alloc(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t align) {
+    if (auto *ptr = counted_aligned_alloc(size, align); ptr != nullptr) {
+        return ptr;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void *operator new[](std::size_t size, std::align_val_t align) {
+    return ::operator new(size, align);
+}
+
+void *operator new(std::size_t size, std::align_val_t align,
+                   const std::nothrow_t &) noexcept {
+    return counted_aligned_alloc(size, align);
+}
+
+void *operator new[](std::size_t size, std::align_val_t align,
+                     const std::nothrow_t &) noexcept {
+    return counted_aligned_alloc(size, align);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
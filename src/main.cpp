@@ -1,25 +1,46 @@
+#include <chrono>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
 
 #include <spdlog/spdlog.h>
 #include <sysd/buffer.hpp>
+#include <sysd/jag/access_profile.hpp>
 #include <sysd/jag/archive.hpp>
+#include <sysd/jag/archive_set.hpp>
+#include <sysd/jag/archive_view.hpp>
+#include <sysd/jag/checksum.hpp>
+#include <sysd/jag/compression_cache.hpp>
+#include <sysd/jag/detail/blocking_queue.hpp>
+#include <sysd/jag/detail/parallel.hpp>
+#include <sysd/jag/index.hpp>
+#include <sysd/jag/log.hpp>
+#include <sysd/jag/overlay.hpp>
 #include <sysd/jag/serialize.hpp>
+#include <sysd/jag/sidecar.hpp>
+#include <sysd/jag/stats.hpp>
+#include <sysd/jag/trace.hpp>
+#include <sysd/jag/verify.hpp>
 
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 #include <boost/program_options.hpp>
 
-boost::optional<sysd::buffer> read_file(const std::string name) {
+boost::optional<sysd::buffer::container_type>
+read_file_data(const std::string name) {
+    sysd::jag::detail::phase_scope scope{sysd::jag::phase::read_file};
     std::ifstream file(name, std::ios::binary);
 
-    if (!file.is_open() && file.good()) {
+    if (!file.is_open()) {
         return boost::none;
     }
 
-    file.unsetf(std::ios::skipws);
     file.seekg(0, std::ios::end);
 
     auto file_size = file.tellg();
@@ -27,30 +48,762 @@ boost::optional<sysd::buffer> read_file(const std::string name) {
     file.seekg(0, std::ios::beg);
 
     sysd::buffer::container_type data{};
-    data.reserve(file_size);
+    data.resize(file_size);
 
-    data.insert(data.begin(), std::istream_iterator<sysd::buffer::type>(file),
-                std::istream_iterator<sysd::buffer::type>());
+    if (!file.read(data.data(), file_size)) {
+        return boost::none;
+    }
 
-    return sysd::buffer{data};
+    scope.bytes_in(data.size());
+    scope.bytes_out(data.size());
+    return data;
+}
+
+boost::optional<sysd::buffer> read_file(const std::string name) {
+    if (auto data = read_file_data(name); data) {
+        return sysd::buffer{std::move(data.value())};
+    }
+
+    return boost::none;
 }
 
 void write_file(const boost::filesystem::path &location,
                 const sysd::buffer &buffer) {
+    sysd::jag::detail::phase_scope scope{sysd::jag::phase::write_file,
+                                         buffer.data().size()};
     std::ofstream out{location.string(), std::ios::trunc | std::ios::binary};
 
     out.write(buffer.data().data(), sizeof(char) * buffer.data().size());
     out.close();
+
+    if (!out) {
+        throw std::runtime_error{
+            fmt::format("unable to write {}", location.string())};
+    }
+
+    scope.bytes_out(buffer.data().size());
+}
+
+struct write_options {
+    sysd::jag::serialize_options serialize{};
+    // also write a .jagidx sidecar next to every archive written
+    bool sidecar{false};
+    // where the checksums of every archive written go, when set
+    std::ostream *checksums{nullptr};
+};
+
+void write_sidecar(const boost::filesystem::path &file,
+                   const sysd::jag::archive &archive,
+                   const sysd::buffer &buffer) {
+    const auto path = sysd::jag::sidecar_path(file);
+    const auto mtime = boost::filesystem::last_write_time(file);
+
+    if (!sysd::jag::write_sidecar(
+            path, sysd::jag::make_sidecar(archive, buffer.data(), mtime))) {
+        sysd::jag::logger().warn("unable to write sidecar {}", path.string());
+    }
 }
 
 void write_archive(const boost::filesystem::path &file,
                    const sysd::jag::archive &archive,
-                   const std::size_t threshold) {
-    const auto buffer = sysd::jag::serialize(archive, threshold);
+                   const write_options &options) {
+    sysd::jag::archive_checksums sums{};
+    auto serialize_opts = options.serialize;
+
+    if (options.checksums != nullptr) {
+        serialize_opts.checksums = &sums;
+    }
+
+    if (options.sidecar) {
+        // the sidecar describes the archive's contents, so keep them around
+        const auto buffer = sysd::jag::serialize(archive, serialize_opts);
+
+        write_file(file, buffer);
+        write_sidecar(file, archive, buffer);
+    } else {
+        std::ofstream out{file.string(), std::ios::trunc | std::ios::binary};
+
+        sysd::jag::serialize(archive, out, serialize_opts);
+
+        if (!out) {
+            throw std::runtime_error{
+                fmt::format("unable to write {}", file.string())};
+        }
+    }
+
+    if (options.checksums != nullptr) {
+        sysd::jag::write_checksums(*options.checksums, file.string(), sums);
+    }
+}
+
+void list_archive(const std::string &name,
+                  const sysd::jag::archive_view &view) {
+    const auto &index = view.index();
+
+    fmt::print("{}: {} entries, {} bytes", name, index.entries.size(),
+               index.decomp_len);
+
+    if (index.compressed()) {
+        fmt::print(" (compressed to {} bytes)", index.comp_len);
+    }
+
+    fmt::print("\n{:>10}  {:>8}  {:>8}  {:>8}  {}\n", "name", "offset",
+               "size", "packed", "compression");
+
+    for (const auto &entry : index.entries) {
+        fmt::print("{:#010x}  {:>8}  {:>8}  {:>8}  {}\n", entry.name,
+                   entry.offset, entry.decomp_len, entry.comp_len,
+                   entry.compressed() ? "bzip2" : "stored");
+    }
+}
+
+using name_table = std::unordered_map<std::uint32_t, std::string>;
+
+name_table read_names(const std::string &file) {
+    std::ifstream in{file};
+    name_table names{};
+
+    for (std::string line{}; std::getline(in, line);) {
+        if (line.empty()) {
+            continue;
+        }
+
+        // names become paths under the output directory, so they mustn't
+        // be able to escape it
+        const boost::filesystem::path path{line};
+
+        if (path.has_root_path() ||
+            std::any_of(std::begin(path), std::end(path),
+                        [](const auto &part) { return part == ".."; })) {
+            sysd::jag::logger().warn("ignoring unsafe entry name {}", line);
+            continue;
+        }
+
+        names.emplace(sysd::jag::detail::encode_entry_name(line), line);
+    }
+
+    return names;
+}
+
+std::string entry_file_name(const name_table &names, std::uint32_t name) {
+    if (auto known = names.find(name); known != std::end(names)) {
+        return known->second;
+    }
+
+    return fmt::format("{:08x}", name);
+}
+
+// Extracts every entry of an archive into dir. Entries are decoded on a pool
+// of worker threads, and handed to the calling thread which writes them out
+// as they arrive, so decoding and writing overlap.
+void extract_all(sysd::jag::archive_view &view,
+                 const boost::filesystem::path &dir, const name_table &names,
+                 const std::size_t jobs,
+                 sysd::jag::archive_checksums *sums = nullptr) {
+    struct decoded_entry {
+        std::uint32_t name;
+        boost::filesystem::path path;
+        sysd::buffer data;
+    };
+
+    using decoded_queue = sysd::jag::detail::blocking_queue<decoded_entry>;
+
+    // Stops the decoders however writing ends. Closing the queue frees any
+    // stuck pushing into it, and a thread mustn't be destroyed unjoined.
+    struct decoders_stop {
+        decoded_queue &queue;
+        std::thread &thread;
+
+        ~decoders_stop() {
+            queue.close();
+
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    };
+
+    boost::filesystem::create_directories(dir);
+
+    // after this the view may be read from concurrently
+    view.decode_body();
+
+    const auto &entries = view.index().entries;
+    // a queue with no room would block every decoder forever
+    decoded_queue decoded{std::max<std::size_t>(jobs, 1) * 2};
+    std::exception_ptr error{};
+
+    // entries are checksummed by the threads decoding them
+    if (sums != nullptr) {
+        sums->archive = sysd::jag::compute_checksum(view.data());
+        sums->entries.resize(entries.size());
+    }
+
+    std::thread decoders{[&] {
+        try {
+            sysd::jag::detail::parallel_for(
+                entries.size(), jobs, [&](std::size_t i) {
+                    const auto &entry = entries[i];
+                    auto data = view.read(entry);
+
+                    if (sums != nullptr) {
+                        sums->entries[i] = {
+                            entry.name,
+                            sysd::jag::compute_checksum(data.data())};
+                    }
+
+                    if (!decoded.push(
+                            {entry.name,
+                             dir / entry_file_name(names, entry.name),
+                             std::move(data)})) {
+                        throw std::runtime_error{"extraction was stopped"};
+                    }
+                });
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        decoded.close();
+    }};
+
+    {
+        const decoders_stop stop{decoded, decoders};
+
+        while (auto entry = decoded.pop()) {
+            sysd::jag::detail::entry_span span{"write", entry->name,
+                                               entry->data.data().size()};
+
+            // known names may sit in directories of their own
+            boost::filesystem::create_directories(entry->path.parent_path());
+
+            write_file(entry->path, entry->data);
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// A single operation from a --manifest file. Each line of a manifest names
+// the archive it applies to, followed by the operation and its arguments:
+//
+//   <archive> insert <file> [entry]
+//   <archive> replace <file> [entry]
+//   <archive> delete <entry>
+//   <archive> rename <entry> <new entry>
+//
+// Blank lines and lines starting with # are ignored. Relative paths are
+// resolved against the manifest's directory.
+struct edit_op {
+    enum class kind { insert, replace, remove, rename };
+
+    kind op;
+    std::string first;
+    std::string second;
+    std::size_t line;
+};
+
+struct archive_edits {
+    boost::filesystem::path archive;
+    std::vector<edit_op> ops{};
+};
+
+std::vector<archive_edits> read_manifest(const std::string &file) {
+    std::ifstream in{file};
+
+    if (!in.is_open()) {
+        throw std::runtime_error{fmt::format("unable to open {}", file)};
+    }
+
+    const auto base = boost::filesystem::absolute(file).parent_path();
+    const auto resolve = [&base](const std::string &path) {
+        return boost::filesystem::absolute(path, base);
+    };
+
+    std::vector<archive_edits> edits{};
+    std::size_t line_no{0};
+
+    for (std::string line{}; std::getline(in, line);) {
+        line_no++;
+
+        std::istringstream tokens{line};
+        std::string archive{}, op{}, first{}, second{};
+
+        if (!(tokens >> archive) || archive[0] == '#') {
+            continue;
+        }
+
+        tokens >> op >> first >> second;
+
+        edit_op edit{};
+        edit.line = line_no;
+
+        if ((op == "insert" || op == "replace") && !first.empty()) {
+            edit.op = op == "insert" ? edit_op::kind::insert
+                                     : edit_op::kind::replace;
+            edit.first = resolve(first).string();
+            edit.second =
+                second.empty()
+                    ? boost::filesystem::path{first}.filename().string()
+                    : second;
+        } else if (op == "delete" && !first.empty() && second.empty()) {
+            edit.op = edit_op::kind::remove;
+            edit.first = first;
+        } else if (op == "rename" && !second.empty()) {
+            edit.op = edit_op::kind::rename;
+            edit.first = first;
+            edit.second = second;
+        } else {
+            throw std::runtime_error{
+                fmt::format("{}:{}: malformed operation", file, line_no)};
+        }
+
+        const auto path = resolve(archive);
+        auto group = std::find_if(
+            std::begin(edits), std::end(edits),
+            [&path](const auto &group) { return group.archive == path; });
+
+        if (group == std::end(edits)) {
+            edits.push_back({path, {}});
+            group = std::prev(std::end(edits));
+        }
+
+        group->ops.push_back(std::move(edit));
+    }
+
+    return edits;
+}
 
-    write_file(file, buffer);
+// Reads an --access-log file. Each line records reads of one entry:
+//
+//   [timestamp] <entry> [count]
+//
+// A line without a count is a single read, and a timestamp, if any, isn't
+// interpreted. Lines are expected in the order the reads happened, which
+// breaks ties between entries read equally often. Blank lines and lines
+// starting with # are ignored.
+sysd::jag::access_profile read_access_log(const std::string &file) {
+    std::ifstream in{file};
+
+    if (!in.is_open()) {
+        throw std::runtime_error{fmt::format("unable to open {}", file)};
+    }
+
+    const auto is_count = [](const std::string &field) {
+        return !field.empty() &&
+               std::all_of(std::begin(field), std::end(field),
+                           [](const char c) { return c >= '0' && c <= '9'; });
+    };
+
+    sysd::jag::access_profile profile{};
+    std::size_t line_no{0};
+
+    for (std::string line{}; std::getline(in, line);) {
+        line_no++;
+
+        std::istringstream tokens{line};
+        std::vector<std::string> fields{};
+
+        for (std::string field{}; tokens >> field;) {
+            fields.push_back(std::move(field));
+        }
+
+        if (fields.empty() || fields[0][0] == '#') {
+            continue;
+        }
+
+        // a lone second field is a count if it can be, otherwise the first
+        // is a timestamp
+        const auto counted =
+            fields.size() == 3 || (fields.size() == 2 && is_count(fields[1]));
+        const auto &entry = fields[fields.size() - (counted ? 2 : 1)];
+
+        if (fields.size() > 3 || (counted && !is_count(fields.back()))) {
+            throw std::runtime_error{
+                fmt::format("{}:{}: malformed access", file, line_no)};
+        }
+
+        profile.record(entry,
+                       counted ? std::stoull(fields.back()) : std::size_t{1});
+    }
+
+    return profile;
+}
+
+// Applies every operation for one archive in memory, then writes it once.
+void apply_edits(const archive_edits &edits, const write_options &options) {
+    auto *log = &sysd::jag::logger();
+    const auto &name = edits.archive.string();
+
+    sysd::jag::archive archive{};
+
+    if (boost::filesystem::exists(edits.archive)) {
+        if (auto buffer = read_file(name); buffer) {
+            archive = sysd::jag::archive{buffer.value()};
+        } else {
+            throw std::runtime_error{fmt::format("unable to open {}", name)};
+        }
+    } else {
+        log->debug("creating new archive {}", name);
+    }
+
+    for (const auto &edit : edits.ops) {
+        switch (edit.op) {
+        case edit_op::kind::replace:
+            if (!archive.get(edit.second)) {
+                log->warn("line {}: no {} to replace in {}", edit.line,
+                          edit.second, name);
+                break;
+            }
+            [[fallthrough]];
+        case edit_op::kind::insert:
+            if (auto data = read_file(edit.first); data) {
+                archive.put(edit.second, data.value());
+            } else {
+                log->warn("line {}: couldn't read file {}", edit.line,
+                          edit.first);
+            }
+            break;
+        case edit_op::kind::remove:
+            if (!archive.remove(edit.first)) {
+                log->warn("line {}: no {} to delete in {}", edit.line,
+                          edit.first, name);
+            }
+            break;
+        case edit_op::kind::rename:
+            if (!archive.rename(edit.first, edit.second)) {
+                log->warn("line {}: couldn't rename {} to {} in {}",
+                          edit.line, edit.first, edit.second, name);
+            }
+            break;
+        }
+    }
+
+    write_archive(edits.archive, archive, options);
+    log->debug("applied {} operations to {}", edits.ops.size(), name);
+}
+
+// Brings an archive up to date with the files in dir, replacing only the
+// entries whose contents differ. Entries are first compared by size, and then
+// by content hash. An entry's hash comes from the archive's sidecar when it
+// has an up to date one, otherwise the entry has to be decoded. The sidecar is
+// rewritten whenever it was missing, stale or the archive changed.
+void sync_archive(const boost::filesystem::path &archive_path,
+                  const boost::filesystem::path &dir,
+                  const write_options &options) {
+    auto *log = &sysd::jag::logger();
+    const auto &name = archive_path.string();
+
+    sysd::buffer::container_type data{};
+
+    if (boost::filesystem::exists(archive_path)) {
+        if (auto contents = read_file_data(name); contents) {
+            data = std::move(contents.value());
+        } else {
+            throw std::runtime_error{fmt::format("unable to open {}", name)};
+        }
+    } else {
+        data = sysd::jag::serialize(sysd::jag::archive{}, options.serialize)
+                   .data();
+    }
+
+    const auto side_path = sysd::jag::sidecar_path(archive_path);
+    auto side = sysd::jag::read_sidecar(side_path);
+
+    if (side && !side->describes(data)) {
+        log->debug("ignoring stale sidecar {}", side_path.string());
+        side = boost::none;
+    }
+
+    // everything below reads through this one view, so however many times
+    // the archive is looked at its body is only decoded once
+    sysd::jag::archive_view view{
+        std::move(data), side ? boost::make_optional(side->to_index())
+                              : boost::none};
+    const auto &index = view.index();
+
+    std::vector<boost::filesystem::path> files{};
+
+    for (const auto &file : boost::filesystem::directory_iterator{dir}) {
+        if (boost::filesystem::is_regular_file(file.status())) {
+            files.push_back(file.path());
+        }
+    }
+
+    std::sort(std::begin(files), std::end(files));
+
+    std::vector<std::tuple<std::string, sysd::buffer>> changed{};
+
+    for (const auto &file : files) {
+        auto contents = read_file_data(file.string());
+
+        if (!contents) {
+            log->warn("couldn't read file {}", file.string());
+            continue;
+        }
+
+        const auto entry_name = file.filename().string();
+        const auto encoded = sysd::jag::detail::encode_entry_name(entry_name);
+        const auto entry = std::find_if(
+            std::begin(index.entries), std::end(index.entries),
+            [encoded](const auto &entry) { return entry.name == encoded; });
+
+        auto unchanged = entry != std::end(index.entries) &&
+                         entry->decomp_len == contents->size();
+
+        if (unchanged) {
+            const auto hash = sysd::jag::detail::content_hash(*contents);
+
+            if (auto known = side ? side->find(encoded) : boost::none; known) {
+                unchanged = known->hash == hash;
+            } else {
+                const auto stored = view.read(*entry);
+                unchanged = sysd::jag::detail::content_hash(stored.data()) ==
+                            hash;
+            }
+        }
+
+        if (!unchanged) {
+            log->debug("{} changed", entry_name);
+            changed.emplace_back(entry_name,
+                                 sysd::buffer{std::move(contents.value())});
+        }
+    }
+
+    if (changed.empty() && side) {
+        log->debug("{} is up to date", name);
+
+        if (options.checksums != nullptr) {
+            sysd::jag::write_checksums(*options.checksums, name,
+                                       sysd::jag::read_checksums(view));
+        }
+
+        return;
+    }
+
+    sysd::jag::archive archive{};
+    archive.reserve(index.entries.size());
+
+    for (const auto &entry : index.entries) {
+        auto contents = view.read(entry);
+        archive.append(entry.name, contents);
+    }
+
+    sysd::buffer raw{view.data()};
+
+    for (auto &[entry_name, contents] : changed) {
+        archive.replace(entry_name, contents);
+    }
+
+    sysd::jag::archive_checksums sums{};
+    auto serialize_opts = options.serialize;
+
+    if (options.checksums != nullptr) {
+        serialize_opts.checksums = &sums;
+    }
+
+    if (!changed.empty() || !boost::filesystem::exists(archive_path)) {
+        const auto buffer = sysd::jag::serialize(archive, serialize_opts);
+
+        write_file(archive_path, buffer);
+        raw = buffer;
+        log->debug("replaced {} entries in {}", changed.size(), name);
+    } else if (options.checksums != nullptr) {
+        sums = sysd::jag::read_checksums(view);
+    }
+
+    write_sidecar(archive_path, archive, raw);
+
+    if (options.checksums != nullptr) {
+        sysd::jag::write_checksums(*options.checksums, name, sums);
+    }
 }
 
+// Verifies every archive, printing what's wrong with each. Archives are
+// verified alongside each other, and the entries of each share whatever
+// threads are left over. Returns non-zero when any archive has a problem.
+int verify_archives(const std::vector<std::string> &archives,
+                    const std::string &manifest_file, const std::size_t jobs) {
+    boost::optional<sysd::jag::checksum_manifest> manifest{};
+
+    if (!manifest_file.empty()) {
+        std::ifstream in{manifest_file};
+
+        if (!in.is_open()) {
+            throw std::runtime_error{
+                fmt::format("unable to open {}", manifest_file)};
+        }
+
+        manifest = sysd::jag::read_checksum_manifest(in);
+    }
+
+    const auto archive_count = std::max<std::size_t>(1, archives.size());
+    const auto entry_jobs = std::max<std::size_t>(1, jobs / archive_count);
+    std::vector<sysd::jag::verify_result> results(archives.size());
+
+    sysd::jag::detail::parallel_for(
+        archives.size(), jobs, [&](std::size_t i) {
+            if (auto data = read_file_data(archives[i]); data) {
+                results[i] = sysd::jag::verify_archive(
+                    archives[i], data.value(), entry_jobs,
+                    manifest.get_ptr());
+            } else {
+                results[i].problems.push_back("couldn't be read");
+            }
+        });
+
+    auto failed = 0;
+
+    for (std::size_t i = 0; i < archives.size(); i++) {
+        if (results[i].ok()) {
+            fmt::print("{}: ok, {} entries\n", archives[i],
+                       results[i].entries);
+            continue;
+        }
+
+        for (const auto &problem : results[i].problems) {
+            fmt::print("{}: {}\n", archives[i], problem);
+        }
+
+        failed++;
+    }
+
+    return failed > 0 ? 1 : 0;
+}
+
+// Logs how much use the compression cache was put to once it goes out of
+// scope, whichever operation ran and however it returned.
+struct cache_report {
+    explicit cache_report(const sysd::jag::compression_cache &cache)
+        : cache{cache} {}
+
+    cache_report(const cache_report &) = delete;
+    cache_report &operator=(const cache_report &) = delete;
+
+    ~cache_report() {
+        sysd::jag::logger().debug("compression cache: {} hits, {} misses",
+                                  cache.hits(), cache.misses());
+    }
+
+  private:
+    const sysd::jag::compression_cache &cache;
+};
+
+// what's recorded while a single archive is processed
+struct archive_recording {
+    sysd::jag::stats_scope stats;
+    sysd::jag::detail::span span;
+};
+
+// Collects the stats of every archive processed for --stats, and prints
+// them once everything is done.
+struct stats_report {
+    explicit stats_report(bool enabled) : enabled{enabled} {}
+
+    // records into a fresh set of stats, and a trace span, for the named
+    // archive while the returned recording lives
+    archive_recording record(const std::string &archive) {
+        if (!enabled) {
+            return {sysd::jag::stats_scope{nullptr},
+                    sysd::jag::detail::span{"archive", archive}};
+        }
+
+        archives.emplace_back(archive, std::make_unique<sysd::jag::stats>());
+        return {sysd::jag::stats_scope{archives.back().second.get()},
+                sysd::jag::detail::span{"archive", archive}};
+    }
+
+    void print_text() const {
+        constexpr auto row = "{:<12} {:>6} {:>10} {:>12} {:>12} {:>8} {:>10}";
+        constexpr auto alloc_row = " {:>10} {:>14}";
+        constexpr auto allocs = sysd::jag::detail::tracking_allocations;
+
+        for (const auto &[archive, stats] : archives) {
+            fmt::print(stderr, "{}\n", archive);
+            fmt::print(stderr, row, "phase", "calls", "time (ms)", "bytes in",
+                       "bytes out", "entries", "rss (KiB)");
+
+            if (allocs) {
+                fmt::print(stderr, alloc_row, "allocs", "alloc bytes");
+            }
+
+            fmt::print(stderr, "\n");
+
+            for (std::size_t i = 0; i < sysd::jag::phase_count; i++) {
+                const auto p = static_cast<sysd::jag::phase>(i);
+                const auto &phase = (*stats)[p];
+
+                if (phase.calls == 0) {
+                    continue;
+                }
+
+                fmt::print(stderr, row, sysd::jag::phase_name(p),
+                           phase.calls.load(),
+                           fmt::format("{:.3f}", phase.nanos / 1e6),
+                           phase.bytes_in.load(),
+                           phase.bytes_out.load(), phase.entries.load(),
+                           phase.peak_rss.load());
+
+                if (allocs) {
+                    fmt::print(stderr, alloc_row, phase.allocations.load(),
+                               phase.allocated_bytes.load());
+                }
+
+                fmt::print(stderr, "\n");
+            }
+        }
+    }
+
+    void print_json() const {
+        fmt::MemoryWriter out{};
+        out << "{\"archives\":[";
+
+        for (std::size_t a = 0; a < archives.size(); a++) {
+            const auto &[archive, stats] = archives[a];
+
+            out << (a > 0 ? "," : "") << "{\"archive\":\""
+                << sysd::jag::detail::json_escape(archive) << "\",\"phases\":{";
+
+            for (std::size_t i = 0, printed = 0; i < sysd::jag::phase_count;
+                 i++) {
+                const auto p = static_cast<sysd::jag::phase>(i);
+                const auto &phase = (*stats)[p];
+
+                if (phase.calls == 0) {
+                    continue;
+                }
+
+                out.write("{}\"{}\":{{\"calls\":{},\"nanos\":{},"
+                          "\"bytes_in\":{},\"bytes_out\":{},"
+                          "\"entries\":{},\"peak_rss_kib\":{}",
+                          printed++ > 0 ? "," : "", sysd::jag::phase_name(p),
+                          phase.calls.load(), phase.nanos.load(),
+                          phase.bytes_in.load(), phase.bytes_out.load(),
+                          phase.entries.load(), phase.peak_rss.load());
+
+                if (sysd::jag::detail::tracking_allocations) {
+                    out.write(",\"allocations\":{},\"allocated_bytes\":{}",
+                              phase.allocations.load(),
+                              phase.allocated_bytes.load());
+                }
+
+                out << "}";
+            }
+
+            out << "}}";
+        }
+
+        out << "]}\n";
+        std::fputs(out.c_str(), stderr);
+    }
+
+  private:
+    bool enabled;
+    std::vector<std::pair<std::string, std::unique_ptr<sysd::jag::stats>>>
+        archives{};
+};
+
 namespace opts = boost::program_options;
 
 opts::options_description generic_opts{"generic options"};
@@ -64,20 +817,64 @@ void init_program_options() {
     using vec_val = std::vector<std::string>;
 
     generic_opts.add_options()("help,h", "prints this help message")(
-        "verbose,v", "enables debug information");
+        "verbose,v", "enables debug information")(
+        "async-log", "logs from a background thread, for verbose batch runs")(
+        "stats", "prints time and bytes spent per phase")(
+        "stats-format", opts::value<str_val>()->default_value("text"),
+        "with --stats, prints them as 'text' or 'json'")(
+        "trace", opts::value<str_val>(),
+        "writes a Chrome trace of everything done to a file");
 
     op_opts.add_options()("create,c", opts::value<str_val>(),
                           "create an empty archive")(
+        "list", "lists an archive's entries without extracting them")(
         "extract,e",
         opts::value<vec_val>()->composing()->default_value({}, "{}"),
         "extracts an archive's entry")(
+        "extract-all,x",
+        "extracts every entry into a directory named after the archive")(
+        "verify", "checks archives decode exactly as they describe")(
+        "verify-checksums", opts::value<str_val>(),
+        "with --verify, also checks archives against a --checksums file")(
+        "names,n", opts::value<str_val>(),
+        "file listing known entry names, one per line")(
+        "jobs,j",
+        opts::value<std::size_t>()->default_value(
+            sysd::jag::detail::default_jobs()),
+        "number of worker threads")(
         "insert,i",
         opts::value<vec_val>()->composing()->default_value({}, "{}"),
         "inserts a file into an archive")(
+        "sync,s", opts::value<str_val>(),
+        "replaces entries which differ from the files in a directory")(
+        "manifest,m", opts::value<str_val>(),
+        "applies the edits listed in a manifest file")(
+        "flatten", opts::value<str_val>(),
+        "merges archives into one, later archives overriding earlier ones")(
         "threshold,t",
         opts::value<std::size_t>()->default_value(
             sysd::jag::archive::compression_threshold),
         "threshold to begin compressing archives")(
+        "layout,l", opts::value<str_val>()->default_value("archive"),
+        "compress the whole 'archive', individual 'entries', or pick the "
+        "smallest with 'auto'")(
+        "level", opts::value<str_val>()->default_value("normal"),
+        "compression effort, 'normal' or 'max' for smaller but slower output")(
+        "decode-budget", opts::value<double>(),
+        "with --layout auto, milliseconds an archive may take to decode")(
+        "compress-all",
+        "compresses data even when it looks incompressible")(
+        "reorder",
+        "groups similar entries together to compress archives better")(
+        "access-log", opts::value<str_val>(),
+        "lays out the entries read most often, per a log of reads, first")(
+        "index",
+        "writes a .jagidx sidecar index next to every archive written")(
+        "checksums", opts::value<str_val>(),
+        "writes the crc32 and sha-256 of every archive written or read, and "
+        "of its entries, to a file")(
+        "cache", opts::value<str_val>(),
+        "directory used to cache compressed data between runs")(
         "output,o", opts::value<str_val>(),
         "specifies the output directory/file");
 
@@ -112,6 +909,314 @@ opts::variables_map parse_arguments(int argc, char **argv) {
     return map;
 }
 
+int run(const opts::variables_map &args,
+        const boost::filesystem::path &out_path, stats_report &report) {
+    auto *log = &sysd::jag::logger();
+
+    auto req_inputs = args["inputs"].as<std::vector<std::string>>();
+    const auto req_extract = args["extract"].as<std::vector<std::string>>();
+    const auto req_insert = args["insert"].as<std::vector<std::string>>();
+    const auto layout = args["layout"].as<std::string>();
+    const auto level = args["level"].as<std::string>();
+
+    write_options write_opts{};
+    auto &serialize_opts = write_opts.serialize;
+
+    serialize_opts.threshold = args["threshold"].as<std::size_t>();
+    serialize_opts.reorder = args.count("reorder") > 0;
+    serialize_opts.estimate = args.count("compress-all") == 0;
+
+    if (args.count("decode-budget")) {
+        serialize_opts.decode_budget =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::duration<double, std::milli>{
+                    args["decode-budget"].as<double>()});
+    }
+    write_opts.sidecar = args.count("index") > 0;
+
+    if (layout == "archive") {
+        serialize_opts.layout = sysd::jag::layout::archive;
+    } else if (layout == "entries") {
+        serialize_opts.layout = sysd::jag::layout::entries;
+    } else if (layout == "auto") {
+        serialize_opts.layout = sysd::jag::layout::automatic;
+    } else {
+        log->critical("unknown layout {}", layout);
+        return 1;
+    }
+
+    if (level == "normal") {
+        serialize_opts.level = sysd::jag::compression_level::normal;
+    } else if (level == "max") {
+        serialize_opts.level = sysd::jag::compression_level::max;
+    } else {
+        log->critical("unknown compression level {}", level);
+        return 1;
+    }
+
+    boost::optional<sysd::jag::access_profile> access{};
+
+    if (args.count("access-log")) {
+        access = read_access_log(args["access-log"].as<std::string>());
+        serialize_opts.access = access.get_ptr();
+    }
+
+    boost::optional<std::ofstream> checksums{};
+
+    if (args.count("checksums")) {
+        const auto file = args["checksums"].as<std::string>();
+
+        checksums.emplace(file, std::ios::trunc);
+
+        if (!checksums->is_open()) {
+            throw std::runtime_error{fmt::format("unable to open {}", file)};
+        }
+
+        write_opts.checksums = checksums.get_ptr();
+    }
+
+    boost::optional<sysd::jag::compression_cache> cache{};
+    boost::optional<cache_report> cache_use{};
+
+    if (args.count("cache")) {
+        cache.emplace(args["cache"].as<std::string>());
+        serialize_opts.cache = cache.get_ptr();
+        cache_use.emplace(cache.value());
+    }
+
+    if (args.count("manifest")) {
+        const auto edits = read_manifest(args["manifest"].as<std::string>());
+
+        for (const auto &archive_edits : edits) {
+            auto recording = report.record(archive_edits.archive.string());
+            apply_edits(archive_edits, write_opts);
+        }
+
+        return 0;
+    }
+
+    if (args.count("sync")) {
+        const auto dir = args["sync"].as<std::string>();
+
+        if (!boost::filesystem::is_directory(dir)) {
+            log->critical("{} isn't a directory", dir);
+            return 1;
+        }
+
+        for (const auto &archive_name : req_inputs) {
+            auto recording = report.record(archive_name);
+            sync_archive(archive_name, dir, write_opts);
+        }
+
+        return 0;
+    }
+
+    if (args.count("create")) {
+        const auto file = args["create"].as<std::string>();
+        const auto out = out_path / file;
+        const sysd::jag::archive archive{};
+        auto recording = report.record(out.string());
+
+        if (boost::filesystem::exists(out)) {
+            log->warn("overwriting existing archive {}", out.string());
+        }
+
+        write_archive(out, archive, write_opts);
+        log->debug("created empty archive {}", out.string());
+
+        if ((req_extract.size() > 0 || req_insert.size() > 0) &&
+            req_inputs.size() == 0) {
+            req_inputs.emplace_back(out.string());
+            log->debug("added {} to input archives", out.string());
+        }
+    }
+
+    if (args.count("flatten")) {
+        const auto out = out_path / args["flatten"].as<std::string>();
+        auto recording = report.record(out.string());
+        sysd::jag::overlay layers{};
+
+        for (const auto &archive_name : req_inputs) {
+            auto data = read_file_data(archive_name);
+
+            if (!data) {
+                log->critical("unable to open {}", archive_name);
+                return 1;
+            }
+
+            layers.add(
+                sysd::jag::open_view(archive_name, std::move(data.value())));
+        }
+
+        write_archive(out, layers.flatten(), write_opts);
+        log->debug("flattened {} archives into {}", req_inputs.size(),
+                   out.string());
+
+        return 0;
+    }
+
+    if (args.count("verify")) {
+        const auto manifest =
+            args.count("verify-checksums")
+                ? args["verify-checksums"].as<std::string>()
+                : std::string{};
+
+        return verify_archives(req_inputs, manifest,
+                               args["jobs"].as<std::size_t>());
+    }
+
+    if (args.count("list")) {
+        for (const auto &archive_name : req_inputs) {
+            auto recording = report.record(archive_name);
+
+            if (auto data = read_file_data(archive_name); data) {
+                auto view = sysd::jag::open_view(archive_name,
+                                                 std::move(data.value()));
+
+                list_archive(archive_name, view);
+
+                if (checksums) {
+                    sysd::jag::write_checksums(
+                        *checksums, archive_name,
+                        sysd::jag::read_checksums(view));
+                }
+            } else {
+                log->warn("couldn't read {}", archive_name);
+            }
+        }
+
+        return 0;
+    }
+
+    if (args.count("extract-all")) {
+        const auto jobs = args["jobs"].as<std::size_t>();
+        const auto names = args.count("names")
+                               ? read_names(args["names"].as<std::string>())
+                               : name_table{};
+
+        for (const auto &archive_name : req_inputs) {
+            auto recording = report.record(archive_name);
+
+            if (auto data = read_file_data(archive_name); data) {
+                auto view = sysd::jag::open_view(archive_name,
+                                                 std::move(data.value()));
+                const auto dir =
+                    out_path /
+                    boost::filesystem::path{archive_name}.stem();
+
+                sysd::jag::archive_checksums sums{};
+
+                extract_all(view, dir, names, jobs,
+                            checksums ? &sums : nullptr);
+
+                if (checksums) {
+                    sysd::jag::write_checksums(*checksums, archive_name,
+                                               sums);
+                }
+
+                log->debug("extracted {} entries from {} to {}",
+                           view.index().entries.size(), archive_name,
+                           dir.string());
+            } else {
+                log->warn("couldn't read {}", archive_name);
+            }
+        }
+
+        return 0;
+    }
+
+    if (req_extract.size() == 0 && req_insert.size() == 0 &&
+        !args.count("create")) {
+        log->warn("no archive operation specified");
+        display_help();
+        return 1;
+    }
+
+    for (const auto &archive_name : req_inputs) {
+        if (boost::filesystem::is_directory(archive_name) &&
+            req_insert.size() == 0) {
+            // a cache directory, so look entries up across its archives
+            auto recording = report.record(archive_name);
+            sysd::jag::archive_set set{archive_name,
+                                       args["jobs"].as<std::size_t>()};
+
+            for (const auto &file : req_extract) {
+                if (auto entry = set.get(file); entry) {
+                    write_file(out_path / file, entry.value());
+                } else {
+                    log->warn("couldn't find {} in {}", file, archive_name);
+                }
+            }
+
+            continue;
+        }
+
+        if (!boost::filesystem::exists(archive_name)) {
+            log->warn("couldn't find {}", archive_name);
+            continue;
+        }
+
+        auto recording = report.record(archive_name);
+        auto data = read_file_data(archive_name);
+
+        if (data && req_insert.size() == 0) {
+            // nothing gets rewritten, so only decode what was asked for
+            auto view = sysd::jag::open_view(archive_name,
+                                             std::move(data.value()));
+
+            for (const auto &file : req_extract) {
+                if (auto entry = view.get(file); entry) {
+                    write_file(out_path / file, entry.value());
+                } else {
+                    log->warn("couldn't find {} in {}", file, archive_name);
+                }
+            }
+
+            if (checksums) {
+                sysd::jag::write_checksums(*checksums, archive_name,
+                                           sysd::jag::read_checksums(view));
+            }
+        } else if (data) {
+            sysd::buffer buffer{std::move(data.value())};
+            sysd::jag::archive archive{buffer};
+
+            for (const auto &file : req_extract) {
+                if (auto data = archive.get(file); data) {
+                    write_file(out_path / file, data->data());
+                } else {
+                    log->warn("couldn't find {} in {}", file, archive_name);
+                }
+            }
+
+            for (const auto &file : req_insert) {
+                if (auto data = read_file(file); data) {
+                    archive.put(file, data.value());
+                    log->debug("inserted {} into {}", file, archive_name);
+                } else {
+                    log->warn("couldn't read file {}", file);
+                }
+            }
+
+            if (req_insert.size() > 0) {
+                const auto out = boost::filesystem::path{archive_name};
+
+                if (boost::filesystem::exists(out) &&
+                    !args.count("create")) {
+                    log->warn("overwriting {}", out.string());
+                }
+
+                write_archive(out, archive, write_opts);
+                log->debug("wrote archive to {}", out.string());
+            }
+        } else {
+            log->critical("unable to open {}", archive_name);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 int main(int argc, char **argv) {
     init_program_options();
     const auto args = parse_arguments(argc, argv);
@@ -125,9 +1230,14 @@ int main(int argc, char **argv) {
         spdlog::set_level(spdlog::level::debug);
     }
 
+    if (args.count("async-log")) {
+        spdlog::set_async_mode(8192);
+    }
+
     auto log = spdlog::stdout_color_mt("jag");
+    sysd::jag::set_logger(log);
 
-    if (!args.count("inputs")) {
+    if (!args.count("inputs") && !args.count("manifest")) {
         log->warn("no input files\n");
         display_help();
         return 1;
@@ -144,81 +1254,44 @@ int main(int argc, char **argv) {
         }
     }
 
-    try {
-        auto req_inputs = args["inputs"].as<std::vector<std::string>>();
-        const auto req_extract = args["extract"].as<std::vector<std::string>>();
-        const auto req_insert = args["insert"].as<std::vector<std::string>>();
-        const auto threshold = args["threshold"].as<std::size_t>();
-
-        if (args.count("create")) {
-            const auto file = args["create"].as<std::string>();
-            const auto out = out_path / file;
-            const sysd::jag::archive archive{};
+    stats_report report{args.count("stats") > 0};
+    sysd::jag::tracer tracer{};
+    auto result = 0;
 
-            if (boost::filesystem::exists(out)) {
-                log->warn("overwriting existing archive {}", out.string());
-            }
-
-            write_archive(out, archive, threshold);
-            log->debug("created empty archive {}", out.string());
-
-            if ((req_extract.size() > 0 || req_insert.size() > 0) &&
-                req_inputs.size() == 0) {
-                req_inputs.emplace_back(out.string());
-                log->debug("added {} to input archives", out.string());
-            }
-        }
+    if (const auto format = args["stats-format"].as<std::string>();
+        format != "text" && format != "json") {
+        log->critical("unknown stats format {}", format);
+        return 1;
+    }
 
-        if (req_extract.size() == 0 && req_insert.size() == 0 &&
-            !args.count("create")) {
-            log->warn("no archive operation specified");
-            display_help();
-            return 1;
-        }
+    try {
+        sysd::jag::trace_scope tracing{args.count("trace") ? &tracer
+                                                           : nullptr};
 
-        for (const auto &archive_name : req_inputs) {
-            if (!boost::filesystem::exists(archive_name)) {
-                log->warn("couldn't find {}", archive_name);
-                continue;
-            }
-            if (auto buffer = read_file(archive_name); buffer) {
-                sysd::jag::archive archive{buffer.value()};
-
-                for (const auto &file : req_extract) {
-                    if (auto data = archive.get(file); data) {
-                        write_file(out_path / file, data->data());
-                    } else {
-                        log->warn("couldn't find {} in {}", file, archive_name);
-                    }
-                }
+        result = run(args, out_path, report);
+    } catch (std::exception &e) {
+        log->critical("uncaught exception: {}", e.what());
+        result = 1;
+    }
 
-                for (const auto &file : req_insert) {
-                    if (auto data = read_file(file); data) {
-                        archive.put(file, data.value());
-                        log->debug("inserted {} into {}", file, archive_name);
-                    } else {
-                        log->warn("couldn't read file {}", file);
-                    }
-                }
+    if (args.count("trace")) {
+        const auto file = args["trace"].as<std::string>();
+        std::ofstream out{file, std::ios::trunc};
 
-                if (req_insert.size() > 0) {
-                    const auto out = boost::filesystem::path{archive_name};
+        tracer.write(out);
 
-                    if (boost::filesystem::exists(out) &&
-                        !args.count("create")) {
-                        log->warn("overwriting {}", out.string());
-                    }
+        if (!out) {
+            log->warn("unable to write trace to {}", file);
+        }
+    }
 
-                    write_archive(out, archive, threshold);
-                    log->debug("wrote archive to {}", out.string());
-                }
-            } else {
-                log->critical("unable to open {}", archive_name);
-                return 1;
-            }
+    if (args.count("stats")) {
+        if (args["stats-format"].as<std::string>() == "json") {
+            report.print_json();
+        } else {
+            report.print_text();
         }
-    } catch (std::exception &e) {
-        log->critical("uncaught exception: {}", e.what());
     }
-    return 0;
-}
+
+    return result;
+}
\ No newline at end of file